@@ -0,0 +1,24 @@
+#ifndef CBOIDS_HUD_H
+#define CBOIDS_HUD_H
+
+#include "wrm-common.h"
+
+/*
+The performance overlay: a rolling frame-time graph, the split between simulating and rendering,
+and the renderer's counters, drawn with two UI widgets in the window's top-left corner
+*/
+
+/* Sets up the HUD, hidden */
+bool boids_hud_init(void);
+
+/* Records one frame: its length, the time spent simulating it, and the flock's size; redraws the HUD when shown */
+void boids_hud_update(float delta_time, double sim_ms, u32 boids);
+
+void boids_hud_setVisible(bool visible);
+
+bool boids_hud_isVisible(void);
+
+void boids_hud_quit(void);
+
+
+#endif
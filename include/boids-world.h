@@ -2,11 +2,77 @@
 #define CBOIDS_WORLD_H
 
 
+// how each boid finds the neighbors it steers by
+typedef enum boids_Neighbor_Mode {
+    BOIDS_NEIGHBORS_GRID,       // every tick, scan the grid cells around the boid
+    BOIDS_NEIGHBORS_VERLET,     // keep a list of each boid's near neighbors, rebuilt only once boids have moved enough
+    BOIDS_NEIGHBORS_KNN,        // steer by a fixed number of nearest boids, however near or far, rather than a radius
+    BOIDS_NEIGHBORS_SAMPLED,    // look at a fixed number of random candidates near each boid: a hard cap on cost per boid
+    BOIDS_NEIGHBORS_HALF_SHELL, // scan 13 of the 26 neighboring cells and credit each pair to both boids: half the distances
+    BOIDS_NEIGHBOR_MODES
+} boids_Neighbor_Mode;
 
-bool boids_world_init(void);
+// how far behind the flock's steering runs under a time budget
+typedef struct boids_Staleness {
+    u32 partitions;         // the flock is cut into
+    u32 steered;            // partitions steered in the last update
+    float mean_ms;          // since each partition last steered, averaged over them
+    float max_ms;           // since the one that has waited longest
+} boids_Staleness;
+
+/* Sets up the world; interactive is false when there is no window to take player input from, verbose prints changes made from the keyboard */
+bool boids_world_init(bool interactive, bool verbose);
 
 void boids_world_update(float delta_time);
 
+/* Gets the number of boids in the flock */
+u32 boids_world_getCount(void);
+
+/* 
+Turns on the quality governor, which trades simulation tick rate, neighbors per boid and trail length 
+for update time whenever world updates run over budget_ms, and wins them back once they are well under it
+0 turns it off and restores full quality; log prints every change of quality
+*/
+void boids_world_setGovernor(float budget_ms, bool log);
+
+/* Feeds the governor the time the last world update took: call once per frame, after updating the world */
+void boids_world_govern(float update_ms);
+
+/*
+Holds each update to budget_ms: rather than whole fixed ticks, it steers as many partitions of the flock as fit,
+round-robin, each over the time since it last steered, while every boid still moves every update
+0 goes back to fixed ticks; log prints how stale the steering runs once a second
+*/
+void boids_world_setTimeBudget(float budget_ms, bool log);
+
+/* Gets the staleness as of the last update: all zero without a time budget */
+void boids_world_getStaleness(boids_Staleness *stats);
+
+/* Picks how boids find their neighbors: the grid by default */
+void boids_world_setNeighborMode(boids_Neighbor_Mode mode);
+
+/* Adds gentle cohesion and alignment toward the wider flock, out well past the perception radius: off by default */
+void boids_world_setFarField(bool enabled);
+
+/* 
+Steers boids far from the camera less often, by fewer neighbors: every 2nd, 4th or 8th tick, whole grid cells at a time, 
+so the cost follows what can be seen rather than the flock's size; off by default
+*/
+void boids_world_setLOD(bool enabled);
+
+/*
+Lets grid cells whose boids have settled into moving as one go to sleep: their boids coast without looking for neighbors
+until the cell or one next to it stirs, or boids are added or removed nearby; off by default
+*/
+void boids_world_setSleeping(bool enabled);
+
+/*
+Caps the boids kept in memory at about budget_bytes' worth: past it, flocks far from the camera are written out whole
+to a memory-mapped file at path, and drift there as one body until the camera or another flock comes near again
+The file is removed as soon as it is opened, so it never outlives the run; 0 pages everything back in and closes it
+*/
+bool boids_world_setPaging(const char *path, size_t budget_bytes);
+
 void boids_world_quit(void);
 
 
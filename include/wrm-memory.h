@@ -11,6 +11,7 @@ struct wrm_Pool {
     size_t element_size;
     size_t cap;
     size_t used;
+    size_t first_free;  // every slot below this is in use: searches start here
     void *data;
     bool *is_used;
 };
@@ -20,10 +20,21 @@ I may also provide a rendering backend based on Vulkan instead of OpenGL.
 
 PROVIDES:
 - rendering primitives: shader, texture, mesh, model
+- a model hierarchy whose world transforms are cached and only recomputed where something moved
+- motion trails backed by a fixed-size GPU ring buffer
+- retained UI widgets (rectangles and text), batched into a single draw
+- reference-counted resources, whose GL objects are deleted in batches once no frame in flight uses them
 - access to a default camera
+- an optional headless mode, rendering to an offscreen framebuffer with no display
+- frame capture to raw Y4M video
+- per-pass CPU and GPU frame timings
+- optional dynamic resolution, steered toward a frame-time budget
+- an optional render thread: all functions here may still be called from the thread that called init;
+    the ones that need GL are forwarded to the render thread and wait for it
 
 REQUIREMENTS:
 - SDL2 must be installed for headers/linking
+- headless mode needs EGL (Mesa's surfaceless platform is preferred) and WRM_RENDER_HEADLESS defined
 - cglm/ must also be in your project's includes, used as header-only lib
 */
 
@@ -39,6 +50,8 @@ Type Declarations
 // window creation arguments
 typedef struct wrm_Window_Data wrm_Window_Data; 
 typedef struct wrm_render_Settings wrm_render_Settings;
+// per-frame CPU and GPU timings
+typedef struct wrm_render_Stats wrm_render_Stats;
 
 // shader-related
 typedef struct wrm_Shader_Defaults wrm_Shader_Defaults;
@@ -129,6 +142,30 @@ struct wrm_render_Settings {
     bool verbose;
     bool errors;
     bool test;
+    bool headless; // render into an offscreen framebuffer with no window (requires building with HEADLESS=1)
+    bool threaded; // draw on a dedicated render thread that owns the GL context
+    float frame_budget_ms;  // when above 0, the 3d pass is drawn at a lower resolution whenever the GPU takes longer than this on a frame
+    float min_render_scale; // lowest fraction of the window size that is drawn at (0 for the default, 0.5)
+};
+
+struct wrm_render_Stats {
+    u64 frame;              // index of the frame these timings belong to
+    double frame_ms;        // wall time of the frame, from the delta_time passed to wrm_render_draw()
+    double cpu_build_ms;    // building the draw list from the model pool
+    double cpu_sort_ms;     // sorting the draw list by GL state
+    double cpu_submit_ms;   // everything in wrm_render_draw() up to the buffer swap
+    double gpu_upload_ms;   // per-frame buffer uploads
+    double gpu_opaque_ms;   // the 3d pass
+    double gpu_ui_ms;       // the UI pass
+    double gpu_total_ms;    // all of the above on the GPU
+    u32 draw_calls;
+    u32 models_drawn;
+    u32 models_culled;      // visible models left out for being outside the view frustum
+    u64 upload_bytes;       // bytes of buffer data sent to the GPU for the frame
+    u32 gl_calls_issued;    // state-changing GL calls made (program, VAO, buffer and texture binds, enables, ...)
+    u32 gl_calls_skipped;   // the same calls dropped for not changing anything
+    bool gpu_bound;         // the GPU took longer on the frame than the CPU took to submit it
+    float render_scale;     // fraction of the window's width and height the 3d pass was drawn at
 };
 
 struct wrm_Texture_Data {
@@ -143,12 +180,13 @@ struct wrm_Mesh_Data {
     float *uvs;             // uv for each vertex
     u32 *indices;           // vertex indices
     bool cw;                // clockwise winding order?
+    bool dynamic;           // updated often: keeps a CPU copy so updates only re-send the vertices that changed
     size_t vtx_cnt;         // number of vertices for which we have data (independent of number of triangles)
     size_t tri_cnt;         // the number of triangles in the mesh
 };
 
 struct wrm_Model { 
-    // these are relative to the parent model
+    // these are relative to the parent model; rot is euler angles in degrees, turning about z, then y, then x
     vec3 pos;
     vec3 rot;
     vec3 scale;
@@ -158,9 +196,10 @@ struct wrm_Model {
     wrm_Handle shader;
 
     bool is_visible;
-    bool is_ui; // whether to draw as part of the UI or not
+    bool is_ui; // whether to draw as part of the UI or not: UI models are placed in window pixels and never culled
 
-    // likely gonna be unused for a while
+    // hierarchy: a parent of 0 means none (model 0 is always the renderer's test model)
+    // children are kept by the renderer and are read-only: use wrm_render_setModelParent() to change them
     wrm_Handle parent;
     u32 child_count;
     wrm_Handle *children;
@@ -186,6 +225,9 @@ void wrm_render_quit(void);
 
 /*
 Cleans up any unused/freed resources and renders all currently visible objects
+GL objects of deleted resources are destroyed together at the start of a frame, after the last frame using them is drawn
+When threaded, this only snapshots the camera and visible models and hands the snapshot to the render thread;
+it blocks only when the render thread is already two frames behind
 */
 void wrm_render_draw(float delta_time);
 
@@ -193,25 +235,82 @@ void wrm_render_draw(float delta_time);
 /*
 Get the window created by the render
 May be needed by other modules
+Returns NULL when running headless
 */
 SDL_Window *wrm_render_getWindow(void);
 
+/*
+Gets the size of what is drawn to, in pixels: the window's drawable area, or the offscreen target when headless
+*/
+void wrm_render_getWindowSize(u32 *width, u32 *height);
+
+/*
+Reads back the most recently drawn frame as tightly-packed RGBA, bottom row first
+dest must be 4 * width * height bytes, or NULL to only query the size
+This stalls the GL pipeline, so it is intended for tests and tools
+*/
+bool wrm_render_readPixels(u8 *dest, u32 *width, u32 *height);
+
+/*
+Gets the timings of the most recent frame whose GPU timer queries have completed
+GPU results arrive a few frames late so that reading them never stalls; frame identifies which frame it was
+*/
+void wrm_render_getStats(wrm_render_Stats *dest);
+
+/*
+Writes a CSV header to out, then one row per frame as each frame's timings complete; NULL stops writing
+*/
+void wrm_render_setStatsCSV(FILE *out);
+
+/*
+Sets the frame time the dynamic resolution scale is steered toward; 0 goes back to drawing at full resolution
+Every few frames, the resolution drops while the GPU's average frame is over budget and slowly recovers while it is well under;
+time spent outside the GPU, in simulation or waiting for vsync, doesn't count
+*/
+void wrm_render_setFrameBudget(float budget_ms);
+
+/*
+Starts recording every drawn frame to out (a file or pipe) as raw Y4M video at the given frame rate
+Frames are read back asynchronously and written from a separate thread; out is not closed by the renderer
+*/
+bool wrm_render_startCapture(FILE *out, u32 fps);
+
+/*
+Stops recording, writing out any frames still in flight
+*/
+void wrm_render_stopCapture(void);
+
 /*
 Creates a shader program using the given frag and vert
+A vertex shader declaring `layout (location = 4) in mat4 i_model;` takes its model matrix per instance, 
+and models sharing it, a texture and a mesh are drawn together with one instanced call;
+otherwise the model matrix is set through `uniform mat4 model;` for each model
 */
 wrm_Option_Handle wrm_render_createShader(const char *vert, const char *frag, bool needs_col, bool needs_tex);
 
+/*
+Deletes a shader: models already using it keep it until they stop, but no new model can take it
+*/
+void wrm_render_deleteShader(wrm_Handle shader);
+
 /*
 Create a texture
 */
 wrm_Option_Handle wrm_render_createTexture(const wrm_Texture_Data *data);
+/* Deletes a texture, once no model uses it */
+void wrm_render_deleteTexture(wrm_Handle texture);
 
 /* Create a mesh */
 wrm_Option_Handle wrm_render_createMesh(const wrm_Mesh_Data *data);
-/* Clones an existing mesh (useful for changing data without affecting all instances of this mesh)*/
+/* Clones an existing mesh (useful for changing data without affecting all instances of this mesh); the copy is made on the GPU */
 wrm_Option_Handle wrm_render_cloneMesh(wrm_Handle mesh);
-/* Updates a mesh's data: IMPORTANT: will update ALL existing instances of this mesh */
+/* 
+Updates a mesh's data: IMPORTANT: will update ALL existing instances of this mesh
+NULL attributes are left as they are; for dynamic meshes, only the range of vertices that changed is re-sent 
+*/
 bool wrm_render_updateMesh(wrm_Handle mesh, const wrm_Mesh_Data *data);
+/* Deletes a mesh, once no model uses it */
+void wrm_render_deleteMesh(wrm_Handle mesh);
 
 // model-related
 
@@ -219,8 +318,8 @@ bool wrm_render_updateMesh(wrm_Handle mesh, const wrm_Mesh_Data *data);
 wrm_Option_Handle wrm_render_createModel(const wrm_Model *data, bool use_default_shader);
 /* Get a model*/
 wrm_Option_Model wrm_render_getModel(wrm_Handle model);
-/* Update a model's position data */
-void wrm_render_updateModelTransform(wrm_Handle model, const vec3 position, const vec3 facing, const vec3 up);
+/* Update a model's position data; world transforms are recomputed at the next draw, for it and its descendants only */
+void wrm_render_updateModelTransform(wrm_Handle model, const vec3 pos, const vec3 rot, const vec3 scale);
 /* Update a model's mesh */
 void wrm_render_updateModelMesh(wrm_Handle model, wrm_Handle mesh);
 /* Update a model's texture*/
@@ -229,6 +328,43 @@ void wrm_render_updateModelTexture(wrm_Handle model, wrm_Handle texture);
 void wrm_render_updateModelShader(wrm_Handle model, wrm_Handle shader);
 /* Update a model as a whole data set*/
 void wrm_render_updateModel(wrm_Handle model, const wrm_Model *data);
+/* Attaches a model to a parent (0 to detach it): the model then moves with the parent; fails if it would make a cycle */
+bool wrm_render_setModelParent(wrm_Handle model, wrm_Handle parent);
+/* Deletes a model; its children become unparented, and its handle may be reused right away */
+void wrm_render_deleteModel(wrm_Handle model);
+
+// trail-related
+
+/* Creates a set of trails: a ring of the last `length` positions of up to `capacity` points, drawn as fading lines */
+wrm_Option_Handle wrm_render_createTrails(u32 capacity, u32 length, wrm_RGBAf color);
+/* 
+Records one new position for each of count points (positions holds count xyz triples, in a consistent point order)
+Only the first `capacity` points are kept; if count changes, every trail restarts since points may have been reordered
+*/
+void wrm_render_pushTrails(wrm_Handle trails, const float *positions, u32 count);
+/* Shows or hides a set of trails; hidden trails keep recording */
+void wrm_render_setTrailsVisible(wrm_Handle trails, bool visible);
+/* Draws only the newest `length` samples of each trail, up to the length they were created with; memory stays the same */
+void wrm_render_setTrailsLength(wrm_Handle trails, u32 length);
+/* Deletes a set of trails */
+void wrm_render_deleteTrails(wrm_Handle trails);
+
+// UI-related: widgets are retained sets of rectangles and text, placed in pixels from the window's bottom-left corner
+// a widget keeps what was added to it until cleared; all visible widgets are drawn together with one draw call,
+// in handle order, and the batch is only rebuilt and re-sent in frames after a widget changed
+
+/* Creates an empty, visible widget */
+wrm_Option_Handle wrm_render_createWidget(void);
+/* Removes everything from a widget, to be added again */
+void wrm_render_clearWidget(wrm_Handle widget);
+/* Adds a solid rectangle to a widget */
+void wrm_render_addWidgetRect(wrm_Handle widget, float x, float y, float width, float height, wrm_RGBAf color);
+/* Adds text to a widget using the built-in 8x8 font: size is each glyph's height and advance in pixels, y is the first line's bottom */
+void wrm_render_addWidgetText(wrm_Handle widget, float x, float y, float size, wrm_RGBAf color, const char *text);
+/* Shows or hides a widget, keeping its contents */
+void wrm_render_setWidgetVisible(wrm_Handle widget, bool visible);
+/* Deletes a widget */
+void wrm_render_deleteWidget(wrm_Handle widget);
 
 // camera-related
 
@@ -0,0 +1,229 @@
+#include "wrm-common.h"
+#include "wrm-render.h"
+#include "boids-hud.h"
+
+/*
+Constants
+*/
+
+#define BOIDS_HUD_HISTORY 120                   // bars in the graph
+
+internal u32 BOIDS_HUD_BAR_FRAMES = 4;          // frames per bar, shown at the slowest of them: the graph is only rebuilt when a bar is added
+
+internal float BOIDS_HUD_MARGIN = 8.0f;         // from the window's top-left corner, in pixels
+internal float BOIDS_HUD_PADDING = 4.0f;
+internal float BOIDS_HUD_TEXT_SIZE = 8.0f;
+internal float BOIDS_HUD_LINE = 10.0f;
+internal u32 BOIDS_HUD_LINES = 6;
+internal float BOIDS_HUD_BAR_WIDTH = 2.0f;
+internal float BOIDS_HUD_GRAPH_HEIGHT = 50.0f;
+internal float BOIDS_HUD_GRAPH_MS = 50.0f;      // frame time at the top of the graph; longer frames are clipped
+internal float BOIDS_HUD_BUDGET_MS = 1000.0f / 60.0f;
+internal u32 BOIDS_HUD_TEXT_PERIOD = 16;        // frames between text refreshes: numbers changing every frame can't be read
+internal u32 BOIDS_HUD_MEM_PERIOD = 4;          // text refreshes between reads of resident memory, which means parsing a file
+
+internal wrm_RGBAf BOIDS_HUD_BACKGROUND = { 0.0f, 0.0f, 0.0f, 0.6f };
+internal wrm_RGBAf BOIDS_HUD_TEXT = { 1.0f, 1.0f, 1.0f, 1.0f };
+internal wrm_RGBAf BOIDS_HUD_GOOD = { 0.3f, 0.9f, 0.3f, 1.0f };     // within the 60 Hz budget
+internal wrm_RGBAf BOIDS_HUD_SLOW = { 0.9f, 0.8f, 0.2f, 1.0f };     // within twice the budget
+internal wrm_RGBAf BOIDS_HUD_BAD = { 0.9f, 0.3f, 0.2f, 1.0f };
+internal wrm_RGBAf BOIDS_HUD_BUDGET_LINE = { 1.0f, 1.0f, 1.0f, 0.4f };
+
+/*
+Globals
+*/
+
+bool hud_visible;
+bool hud_refresh;       // the text is redrawn on the next update, without waiting for the period
+u32 hud_height;         // of the window, in pixels
+wrm_Handle hud_text;    // the background panel and every line of numbers
+wrm_Handle hud_graph;   // the frame-time bars, redrawn only when a bar is added or the HUD is shown
+
+float hud_bar_ms[BOIDS_HUD_HISTORY]; // ring of recent bars: the slowest frame in each
+u32 hud_head;           // next slot in the ring
+float hud_slowest_ms;   // of the frames since the last bar
+u32 hud_bar_frames;     // frames since the last bar
+
+u32 hud_frames;         // frames since the text was last refreshed, and the times summed over them
+double hud_frame_ms;
+double hud_sim_ms;
+double hud_cost_ms;     // the HUD's own
+u32 hud_refreshes;      // of the text, counting toward the next read of resident memory
+double hud_mem_mb;      // as of the last read
+
+/*
+Internal helper declarations
+*/
+
+/* Rebuilds the panel and its text from the latest stats */
+internal void boids_hud_drawText(u32 boids);
+/* Rebuilds the frame-time graph from the ring */
+internal void boids_hud_drawGraph(void);
+/* Gets the process' resident memory in MB, or a negative number where that isn't available */
+internal double boids_hud_residentMB(void);
+
+/*
+Module functions
+*/
+
+bool boids_hud_init(void)
+{
+    wrm_render_getWindowSize(NULL, &hud_height);
+
+    wrm_Option_Handle text = wrm_render_createWidget();
+    wrm_Option_Handle graph = wrm_render_createWidget();
+    if(!text.exists || !graph.exists) {
+        fprintf(stderr, "ERROR: HUD: failed to create widgets\n");
+        if(text.exists) wrm_render_deleteWidget(text.Handle_val);
+        if(graph.exists) wrm_render_deleteWidget(graph.Handle_val);
+        return false;
+    }
+    // the panel is in the text widget, so it has to come first to be drawn underneath
+    hud_text = text.Handle_val;
+    hud_graph = graph.Handle_val;
+
+    hud_head = 0;
+    hud_slowest_ms = 0.0f;
+    hud_bar_frames = 0;
+    memset(hud_bar_ms, 0, sizeof(hud_bar_ms));
+
+    boids_hud_setVisible(false);
+    return true;
+}
+
+void boids_hud_update(float delta_time, double sim_ms, u32 boids)
+{
+    u64 start = SDL_GetPerformanceCounter();
+
+    float frame_ms = delta_time * 1000.0f;
+    if(frame_ms > hud_slowest_ms) hud_slowest_ms = frame_ms;
+    bool bar = ++hud_bar_frames >= BOIDS_HUD_BAR_FRAMES;
+    if(bar) {
+        hud_bar_ms[hud_head] = hud_slowest_ms;
+        hud_head = (hud_head + 1) % BOIDS_HUD_HISTORY;
+        hud_slowest_ms = 0.0f;
+        hud_bar_frames = 0;
+    }
+
+    // hidden, the HUD only keeps its history
+    if(!hud_visible) return;
+
+    hud_frame_ms += frame_ms;
+    hud_sim_ms += sim_ms;
+    hud_frames++;
+
+    // every change to a widget re-sends the whole UI, so the widgets only change when there is something new to show
+    if(bar || hud_refresh) boids_hud_drawGraph();
+    if(hud_refresh || hud_frames >= BOIDS_HUD_TEXT_PERIOD) {
+        boids_hud_drawText(boids);
+        hud_frame_ms = 0.0;
+        hud_sim_ms = 0.0;
+        hud_cost_ms = 0.0;
+        hud_frames = 0;
+        hud_refresh = false;
+    }
+
+    hud_cost_ms += (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+void boids_hud_setVisible(bool visible)
+{
+    hud_visible = visible;
+    wrm_render_setWidgetVisible(hud_text, visible);
+    wrm_render_setWidgetVisible(hud_graph, visible);
+    // fill the text and graph in on the next update, rather than a period later
+    hud_refresh = visible;
+    hud_frame_ms = 0.0;
+    hud_sim_ms = 0.0;
+    hud_cost_ms = 0.0;
+    hud_frames = 0;
+    hud_refreshes = 0;
+}
+
+bool boids_hud_isVisible(void)
+{
+    return hud_visible;
+}
+
+void boids_hud_quit(void)
+{
+    wrm_render_deleteWidget(hud_text);
+    wrm_render_deleteWidget(hud_graph);
+    hud_visible = false;
+}
+
+/*
+Internal helper definitions
+*/
+
+internal void boids_hud_drawText(u32 boids)
+{
+    wrm_render_Stats stats;
+    wrm_render_getStats(&stats);
+
+    u32 frames = hud_frames ? hud_frames : 1;
+    double average = hud_frame_ms / frames;
+    if(hud_refreshes++ % BOIDS_HUD_MEM_PERIOD == 0) hud_mem_mb = boids_hud_residentMB();
+
+    char text[512];
+    int len = snprintf(text, sizeof(text),
+        "frame %6.2fms %5.1f fps\n"
+        "sim %6.2fms render %6.2fms\n"
+        "upload %6.2fms %7.1f KB\n"
+        "draws %u models %u culled %u\n"
+        "boids %u scale %.2f gl %u/%u\n",
+        average, average > 0.0 ? 1000.0 / average : 0.0,
+        hud_sim_ms / frames, stats.cpu_submit_ms,
+        stats.gpu_upload_ms, stats.upload_bytes / 1024.0,
+        stats.draw_calls, stats.models_drawn, stats.models_culled,
+        boids, stats.render_scale, stats.gl_calls_issued, stats.gl_calls_skipped
+    );
+    // no /proc to read: leave the number out rather than show a made-up one
+    if(hud_mem_mb >= 0.0) len += snprintf(text + len, sizeof(text) - len, "mem %.1f MB ", hud_mem_mb);
+    snprintf(text + len, sizeof(text) - len, "hud %.3fms", hud_cost_ms / frames);
+
+    float top = hud_height - BOIDS_HUD_MARGIN;
+    float width = BOIDS_HUD_HISTORY * BOIDS_HUD_BAR_WIDTH;
+    float height = BOIDS_HUD_LINES * BOIDS_HUD_LINE + BOIDS_HUD_GRAPH_HEIGHT + 3 * BOIDS_HUD_PADDING;
+
+    wrm_render_clearWidget(hud_text);
+    wrm_render_addWidgetRect(hud_text, BOIDS_HUD_MARGIN, top - height, width + 2 * BOIDS_HUD_PADDING, height, BOIDS_HUD_BACKGROUND);
+    wrm_render_addWidgetText(hud_text, BOIDS_HUD_MARGIN + BOIDS_HUD_PADDING, top - BOIDS_HUD_PADDING - BOIDS_HUD_TEXT_SIZE,
+        BOIDS_HUD_TEXT_SIZE, BOIDS_HUD_TEXT, text);
+}
+
+internal void boids_hud_drawGraph(void)
+{
+    float left = BOIDS_HUD_MARGIN + BOIDS_HUD_PADDING;
+    float bottom = hud_height - BOIDS_HUD_MARGIN - BOIDS_HUD_LINES * BOIDS_HUD_LINE - 2 * BOIDS_HUD_PADDING - BOIDS_HUD_GRAPH_HEIGHT;
+    float per_ms = BOIDS_HUD_GRAPH_HEIGHT / BOIDS_HUD_GRAPH_MS;
+
+    wrm_render_clearWidget(hud_graph);
+    // oldest on the left
+    for(u32 i = 0; i < BOIDS_HUD_HISTORY; i++) {
+        float ms = hud_bar_ms[(hud_head + i) % BOIDS_HUD_HISTORY];
+        if(ms <= 0.0f) continue;
+        wrm_RGBAf color = ms <= BOIDS_HUD_BUDGET_MS ? BOIDS_HUD_GOOD : ms <= 2.0f * BOIDS_HUD_BUDGET_MS ? BOIDS_HUD_SLOW : BOIDS_HUD_BAD;
+        float height = glm_min(ms, BOIDS_HUD_GRAPH_MS) * per_ms;
+        wrm_render_addWidgetRect(hud_graph, left + i * BOIDS_HUD_BAR_WIDTH, bottom, BOIDS_HUD_BAR_WIDTH, height, color);
+    }
+    wrm_render_addWidgetRect(hud_graph, left, bottom + BOIDS_HUD_BUDGET_MS * per_ms, BOIDS_HUD_HISTORY * BOIDS_HUD_BAR_WIDTH, 1.0f, BOIDS_HUD_BUDGET_LINE);
+}
+
+internal double boids_hud_residentMB(void)
+{
+    FILE *fp = fopen("/proc/self/status", "r");
+    if(!fp) return -1.0;
+
+    char line[128];
+    double mb = -1.0;
+    while(fgets(line, sizeof(line), fp)) {
+        unsigned long kb;
+        if(sscanf(line, "VmRSS: %lu kB", &kb) == 1) {
+            mb = kb / 1024.0;
+            break;
+        }
+    }
+    fclose(fp);
+    return mb;
+}
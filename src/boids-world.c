@@ -1,3 +1,9 @@
+#define _POSIX_C_SOURCE 200809L // mmap and ftruncate, for paging flocks out to a file
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "wrm-common.h"
 #include "wrm-input.h"
 #include "wrm-render.h"
@@ -12,6 +18,207 @@ Internal type definitions
 DEFINE_LIST(wrm_Handle, Handle);
 DEFINE_LIST(wrm_List_Handle, List_Handle);
 
+// the flock, stored as parallel arrays: the neighbor search only ever walks positions and velocities
+typedef struct boids_Flock {
+    u32 count;
+    u32 cap;
+    vec3 *pos;
+    vec3 *vel;
+    vec3 *next_vel;         // scratch: every boid steers from the same tick's state
+    u32 *steered;           // the tick each boid last steered on: far ones skip ticks
+    wrm_Handle *models;
+} boids_Flock;
+
+// each boid's neighbor candidates, gathered out to the perception radius plus a skin and kept in compressed rows;
+// they stay good until some boid has moved half the skin relative to the rest, however many ticks that takes
+typedef struct boids_Verlet {
+    bool stale;             // boids were added, removed or reordered: rebuild before the next use
+    u32 boid_cnt;           // boids the lists were built for
+    u32 row_cap;
+    u32 *start;             // boid_cnt + 1 entries: boid i's candidates are boids[start[i]..start[i + 1])
+    vec3 *ref_pos;          // each boid's position when the lists were built
+    u32 cap;
+    u32 *boids;
+} boids_Verlet;
+
+// what one boid has seen of its neighbors so far in a tick
+typedef struct boids_Steer {
+    vec3 separation;
+    vec3 alignment;
+    vec3 cohesion;
+    u32 neighbors;
+    vec3 far_pos;           // sums over the boids within the far-field radius, from the aggregate pyramid
+    vec3 far_vel;
+    float far_count;        // cells on the radius's edge are only partly counted
+    u32 max_neighbors;      // gathering stops here: fewer far from the camera
+    float dt;               // seconds to steer for: 0 when the boid sits this tick out
+} boids_Steer;
+
+// a cell's boids summed up: enough to stand in for all of them, seen from far enough away
+typedef struct boids_Aggregate {
+    i32 coord[3];
+    u32 count;
+    vec3 pos_sum;
+    vec3 vel_sum;
+} boids_Aggregate;
+
+// the flock within the far-field radius of one grid cell, as seen from its center of mass
+typedef struct boids_Far {
+    bool known;             // worked out this tick
+    float count;            // cells on the radius's edge are only partly counted
+    vec3 pos_sum;
+    vec3 vel_sum;
+} boids_Far;
+
+// open-addressing hash from integer cell coordinates to an index, probed linearly
+typedef struct boids_Map_Slot {
+    i32 key[3];
+    u32 value;              // BOIDS_NONE when the slot is empty
+} boids_Map_Slot;
+
+typedef struct boids_Map {
+    u32 count;
+    u32 cap;                // slots: a power of two, kept at least twice count
+    boids_Map_Slot *slots;
+} boids_Map;
+
+// a cell of space with boids in it: created when the first boid enters, recycled when the last one leaves
+typedef struct boids_Chunk {
+    i32 coord[3];
+    u32 count;              // boids in it as of the last sort
+    u32 start;              // they are cell_boids[start..start + count)
+    u32 tier;               // level of detail, from the distance to the camera: its boids steer every 2^tier ticks
+    u32 entered;            // boids that came in at the last sort, counting any it can't tell about, until settling reads them
+    float activity;         // how unsettled its boids are, as of this tick: under 1 is quiet
+    u32 quiet_ticks;        // ticks in a row it has been quiet
+    bool asleep;            // its boids coast, without looking for neighbors
+    u32 split;              // sub-cells per axis its boids are sorted into: more than 1 only for crowded chunks in the topological mode
+    u32 sub;                // where its sub-cells' starts are in the grid's table
+    u32 around[27];         // the chunks around it by (z, y, x) offset, itself in the middle; BOIDS_NONE where empty
+} boids_Chunk;
+
+// sparse grid over unbounded space: chunks are kept only where there are boids, found by their integer coordinates,
+// so memory follows the volume the flock occupies rather than its bounds; the boids are re-sorted every tick
+typedef struct boids_Grid {
+    float cell_size;
+    u32 cell_cnt;           // chunks holding boids as of the last sort: 0 if it failed
+    u32 boid_cnt;           // boids in the flock as of the last sort
+    wrm_Pool chunks;        // of boids_Chunk
+    boids_Map map;          // chunk coordinates to chunk handles
+    u32 *cell_boids;        // boid indices, grouped by chunk
+    u32 *boid_cell;         // each boid's chunk
+    u32 *sub_start;         // for each split chunk, where each of its sub-cells starts in cell_boids, then where the last ends
+    u32 sub_cap;
+    u32 *scratch;           // a boid index per boid, for sorting chunks into sub-cells
+} boids_Grid;
+
+// one level of the aggregate pyramid: its occupied cells, and a map to find them by coordinates
+typedef struct boids_Level {
+    boids_Map map;
+    u32 cnt;
+    u32 cap;
+    boids_Aggregate *cells;
+} boids_Level;
+
+#define BOIDS_PYRAMID_MAX_LEVELS 16
+
+// the flock summed into ever coarser cells, each covering 2x2x2 of the level below, up to cells at least as wide as
+// the far-field radius; rebuilt every tick from the boids' current positions
+typedef struct boids_Pyramid {
+    u32 levels;
+    boids_Level level[BOIDS_PYRAMID_MAX_LEVELS];
+    boids_Far *far;         // one per level 0 cell, filled as boids in the cell need it
+    u32 far_cap;
+} boids_Pyramid;
+
+// one paged-out boid, relative to its flock's center and mean velocity
+typedef struct boids_Record {
+    vec3 pos;
+    vec3 vel;
+} boids_Record;
+
+// a run of records in the backing file
+typedef struct boids_Extent {
+    u32 start;
+    u32 count;
+} boids_Extent;
+
+DEFINE_LIST(boids_Extent, Extent);
+
+// a flock paged out whole: it drifts as one body until the camera or another flock comes near
+typedef struct boids_Paged {
+    boids_Extent records;
+    vec3 center;
+    vec3 vel;               // the flock's mean velocity
+    float radius;           // of a sphere around the center holding all its boids
+    u32 tick;               // when it was last moved
+} boids_Paged;
+
+DEFINE_LIST(boids_Paged, Paged);
+
+// chunks that touch, directly or through others: no boid in one sees a boid outside it, so it pages out whole
+typedef struct boids_Island {
+    u32 count;
+    vec3 center;            // of its boids
+    vec3 vel;               // their mean velocity
+    float radius;
+    float distance;         // from the camera to its sphere
+    u32 paged;              // its entry in the paged list once chosen to go out, else BOIDS_NONE
+    u32 written;            // boids written to the file so far
+} boids_Island;
+
+// keeps the resident flock within a budget by writing islands far from the camera out to a memory-mapped file
+typedef struct boids_Pager {
+    u32 budget;             // resident boids: 0 when paging is off
+    int fd;
+    boids_Record *records;  // the whole file, mapped
+    u32 cap;                // records the file has room for
+    u32 end;                // records from here on are unused
+    wrm_List_Extent gaps;   // unused runs before end, sorted and never touching
+    wrm_List_Paged paged;
+    u32 paged_boids;
+    u32 chunk_cap;          // scratch below is sized to the chunk pool: there are never more islands than chunks
+    u32 *chunk_island;      // each chunk's island, found by union-find
+    boids_Island *islands;
+    u32 *order;             // islands, farthest first
+    bool *evicted;          // scratch: the boids going out
+    u32 evicted_cap;
+} boids_Pager;
+
+// steers the flock a partition at a time, round-robin, for as long as each update's time budget lasts
+typedef struct boids_Scheduler {
+    float budget_ms;        // 0 when updates run whole fixed ticks instead
+    bool log;
+    double time;            // seconds simulated so far
+    u32 next;               // the partition the next update starts with
+    u32 partitions;         // the flock was cut into last update: any past these are new to the next
+    u32 cap;
+    double *steered;        // when each partition last steered
+    double move_ms;         // what moving every boid took last update: held back from the steering budget
+    boids_Staleness stats;  // as of the last update
+    u32 log_updates;        // since the last log line
+    u32 log_steered;
+    float log_max_ms;
+    double log_time;
+} boids_Scheduler;
+
+// one rung of the quality ladder the governor moves along
+typedef struct boids_Quality {
+    float tick;             // seconds simulated per tick
+    u32 max_neighbors;
+    u32 trail_length;
+    float lod_scale;        // of the level-of-detail distances
+} boids_Quality;
+
+// steers the quality level toward a budget for the world's updates, from their smoothed time
+typedef struct boids_Governor {
+    float budget_ms;        // 0 when the governor is off
+    bool log;
+    u32 level;              // index into BOIDS_QUALITY: 0 is full quality
+    float update_ms;        // exponentially smoothed update time
+    u32 frames;             // frames since the level last changed
+} boids_Governor;
+
 /*
 Constants
 */
@@ -24,11 +231,103 @@ internal SDL_Scancode BOIDS_RIGHT = SDL_SCANCODE_D;
 internal SDL_Scancode BOIDS_BACKWARD = SDL_SCANCODE_S;
 internal SDL_Scancode BOIDS_UP = SDL_SCANCODE_SPACE;
 internal SDL_Scancode BOIDS_DOWN = SDL_SCANCODE_LCTRL;
+internal SDL_Scancode BOIDS_TOGGLE_TRAILS = SDL_SCANCODE_T;
+internal SDL_Scancode BOIDS_CYCLE_NEIGHBORS = SDL_SCANCODE_N;
+internal SDL_Scancode BOIDS_TOGGLE_FAR_FIELD = SDL_SCANCODE_F;
+internal SDL_Scancode BOIDS_TOGGLE_LOD = SDL_SCANCODE_L;
+internal SDL_Scancode BOIDS_TOGGLE_SLEEP = SDL_SCANCODE_Z;
 
 internal float BOIDS_SENSITIVITY_X = 0.3f; 
 internal float BOIDS_SENSITIVITY_Y = 0.3f;
 internal bool INVERTED = false;
 
+// flock settings
+
+internal float BOIDS_TICK = 1.0f / 60.0f;       // the simulation runs at a fixed rate, independent of the frame rate
+internal u32 BOIDS_MAX_TICKS = 4;               // ticks run in one update at most, so a slow frame can't snowball
+internal u32 BOIDS_INITIAL_COUNT = 1024;
+internal float BOIDS_PERCEPTION = 2.5f;         // radius within which boids see each other
+internal float BOIDS_SEPARATION = 1.0f;         // radius within which boids push each other away
+internal u32 BOIDS_MAX_NEIGHBORS = 32;          // neighbors considered per boid: bounds the cost in dense clumps
+internal u32 BOIDS_CHUNK_POOL = 256;            // chunks allocated up front: the pool grows as the flock spreads
+internal u32 BOIDS_MAP_SLOTS = 512;             // hash slots allocated up front
+#define BOIDS_NONE UINT32_MAX                   // no chunk, cell or map entry
+internal float BOIDS_VERLET_SKIN = 1.0f;        // slack around the perception radius that neighbor lists cover
+internal u32 BOIDS_VERLET_CANDIDATES = 64;      // list entries per boid: room past the neighbor cap for those in the skin
+#define BOIDS_KNN_MAX_K 16
+internal u32 BOIDS_KNN_K = 7;                   // neighbors per boid in the topological mode, as starlings are observed to use
+internal u32 BOIDS_KNN_MAX_SHELLS = 3;          // how many cells out the search goes before a lone boid settles for fewer
+internal u32 BOIDS_KNN_CELL_BOIDS = 16;         // boids per sub-cell the topological mode splits crowded chunks toward
+internal u32 BOIDS_KNN_MAX_SPLIT = 16;          // sub-cells per axis of the most crowded chunks
+internal u32 BOIDS_SAMPLES = 16;                // candidates looked at per boid in the sampled mode, however many there are
+#define BOIDS_LOD_TIERS 4
+internal float BOIDS_LOD_DISTANCE[BOIDS_LOD_TIERS - 1] = { 60.0f, 120.0f, 240.0f }; // past each, boids steer half as often
+internal float BOIDS_LOD_SCALE = 1.0f;          // of the distances: the governor pulls them in
+internal float BOIDS_LOD_HYSTERESIS = 8.0f;     // how far past a distance a chunk goes before it drops a tier
+internal u32 BOIDS_LOD_MIN_NEIGHBORS = 4;       // the neighbor cap halves with each tier, down to this
+internal float BOIDS_SLEEP_VARIANCE = 0.01f;    // of a chunk's velocities over their mean square, below which its boids move as one
+internal float BOIDS_SLEEP_CHURN = 0.1f;        // share of a chunk's boids coming in per sort, below which it has settled
+internal u32 BOIDS_SLEEP_TICKS = 30;            // ticks a chunk stays quiet before it sleeps
+internal float BOIDS_WAKE_ACTIVITY = 2.0f;      // a neighbor this unsettled wakes a chunk; one only just stirred leaves it be
+internal float BOIDS_FAR_PERCEPTION = 12.0f;    // radius of the far field, answered from cell aggregates
+internal float BOIDS_FAR_OPENING = 0.5f;        // cells straddling its edge smaller than this share of it are taken in part
+internal float BOIDS_FAR_COHESION_WEIGHT = 0.05f;
+internal float BOIDS_FAR_ALIGNMENT_WEIGHT = 0.2f;
+internal float BOIDS_SEPARATION_WEIGHT = 4.0f;
+internal float BOIDS_ALIGNMENT_WEIGHT = 1.0f;
+internal float BOIDS_COHESION_WEIGHT = 0.5f;
+internal float BOIDS_BOUNDS_WEIGHT = 0.5f;
+internal float BOIDS_MIN_SPEED = 2.0f;
+internal float BOIDS_MAX_SPEED = 6.0f;
+internal float BOIDS_BOUNDS_RADIUS = 40.0f;     // boids are steered back once they stray this far from the flock's home
+internal vec3 BOIDS_HOME = { 40.0f, 0.0f, 0.0f };
+
+// spawning and removing boids with the mouse
+internal u32 BOIDS_SPAWN_COUNT = 64;
+internal float BOIDS_SPAWN_DISTANCE = 10.0f;    // how far in front of the player boids are spawned and removed
+internal float BOIDS_SPAWN_RADIUS = 2.0f;
+internal float BOIDS_REMOVE_RADIUS = 5.0f;
+
+// steering under a time budget
+internal u32 BOIDS_PARTITION = 256;             // boids steered between looks at the clock
+internal float BOIDS_LOG_PERIOD = 1.0f;         // seconds between log lines
+
+// paging flocks out under a memory budget
+internal u32 BOIDS_RESIDENT_BYTES = 256;        // a boid's share of memory: its arrays, model, grid entries and trail
+internal u32 BOIDS_PAGE_PERIOD = 30;            // ticks between paging checks
+internal float BOIDS_PAGE_IN_DISTANCE = 150.0f; // paged flocks come back within this of the camera
+internal float BOIDS_PAGE_OUT_DISTANCE = 250.0f; // and only go out past this, so one on the line doesn't go back and forth
+internal u32 BOIDS_PAGE_FILE_RECORDS = 1 << 16; // the backing file's first size; it doubles as it fills
+
+// trails: memory is fixed at capacity * length samples however large the flock grows
+internal u32 BOIDS_TRAIL_CAPACITY = 100000;     // boids past this many have no trail
+internal u32 BOIDS_TRAIL_LENGTH = 32;            // samples kept: lower quality levels draw only the newest of them
+internal wrm_RGBAf BOIDS_TRAIL_COLOR = { 0.6f, 0.8f, 1.0f, 0.6f };
+
+// quality levels, best first: each gives up some fidelity to the next, cheapest where it is least visible
+internal const boids_Quality BOIDS_QUALITY[] = {
+    { 1.0f / 60.0f, 32, 32, 1.0f },
+    { 1.0f / 60.0f, 16, 24, 0.85f },
+    { 1.0f / 45.0f, 12, 16, 0.7f },
+    { 1.0f / 30.0f,  8, 12, 0.5f },
+    { 1.0f / 30.0f,  4,  8, 0.35f },
+};
+#define BOIDS_QUALITY_LEVELS (sizeof(BOIDS_QUALITY) / sizeof(BOIDS_QUALITY[0]))
+
+// the governor drops a level quickly when over budget, and climbs back only after a long stretch well under it
+internal float BOIDS_GOVERNOR_SMOOTHING = 0.1f;     // weight of the newest update in the smoothed update time
+internal float BOIDS_GOVERNOR_HEADROOM = 0.75f;     // share of the budget updates must stay under to climb
+internal u32 BOIDS_GOVERNOR_DROP_FRAMES = 30;       // frames at a level before it may drop
+internal u32 BOIDS_GOVERNOR_CLIMB_FRAMES = 180;     // frames at a level before it may climb
+
+// a max-heap of the k nearest boids found so far, farthest on top
+typedef struct boids_Nearest {
+    float d2[BOIDS_KNN_MAX_K];
+    u32 boid[BOIDS_KNN_MAX_K];
+    u32 found;
+    u32 k;
+} boids_Nearest;
+
 /*
 Globals
 */
@@ -49,12 +348,34 @@ bool player_inverted;
 
 // screen controls-related
 bool has_mouse;
+bool is_interactive; // false when running headless: no input module to read from
+bool is_verbose;     // prints changes made from the keyboard
 
 // boids-related
 
-wrm_Pool the_boids; // this sounds ominous as hell lmao
+boids_Flock the_boids; // this sounds ominous as hell lmao
+boids_Grid the_grid;
+boids_Verlet verlet;
+boids_Steer *steers; // every boid's sums at once, for the modes that add to two boids per pair
+u32 steer_cap;
+boids_Pyramid pyramid;
+bool far_field;
+bool lod; // far boids steer less often, by fewer neighbors
+bool sleeping; // chunks whose boids have settled stop steering them
+boids_Pager pager;
+boids_Neighbor_Mode neighbor_mode;
 wrm_Pool the_obstacles;
 
+wrm_Handle boid_mesh;
+float tick_time; // time not yet simulated, less than one tick
+u32 ticks_run; // ticks simulated so far, so per-tick random choices differ from tick to tick
+
+wrm_Option_Handle trails; // created the first time trails are shown
+bool show_trails;
+
+boids_Governor governor;
+boids_Scheduler scheduler;
+
 wrm_List_List_Handle; // this is some goofy shit
 
 /*
@@ -67,12 +388,115 @@ internal wrm_Option_Handle boids_loadImage(const char *path);
 internal char *boids_loadText(const char *path, u32 *length);
 /* Handles user input */
 internal void boids_handlePlayerControls(float delta_time);
+/* Gets the point in front of the player where boids are spawned and removed */
+internal void boids_getTarget(vec3 target);
+/* Adds count boids at random positions within radius of center, with random headings */
+internal void boids_spawn(const vec3 center, float radius, u32 count);
+/* Removes every boid within radius of center */
+internal void boids_remove(const vec3 center, float radius);
+/* Makes room in the flock's arrays for count more boids */
+internal bool boids_reserve(u32 count);
+/* Creates boid i's model, at its position */
+internal bool boids_createModel(u32 i);
+/* Sorts the boids into chunks at least cell_size wide, creating and recycling chunks as boids come and go */
+internal void boids_buildGrid(float cell_size);
+/* Gets the integer coordinates of the cell a position is in */
+internal void boids_coordOf(const vec3 pos, float cell_size, i32 coord[3]);
+/* Halves a cell coordinate, rounding down: the coordinate of the cell covering it a level up */
+internal inline i32 boids_halve(i32 n);
+/* Looks a cell up by its coordinates; BOIDS_NONE if it isn't in the map */
+internal u32 boids_mapFind(const boids_Map *m, const i32 key[3]);
+/* Adds a cell to the map, which must not have it already; false if the map couldn't grow */
+internal bool boids_mapInsert(boids_Map *m, const i32 key[3], u32 value);
+/* Takes a cell out of the map, if it is there */
+internal void boids_mapRemove(boids_Map *m, const i32 key[3]);
+/* Empties the map, keeping its slots */
+internal void boids_mapClear(boids_Map *m);
+/* Hashes cell coordinates */
+internal inline u32 boids_mapHash(const i32 key[3]);
+/* Advances the flock by one fixed tick */
+internal void boids_tick(float dt);
+/* Steers as many partitions of the flock as the time budget allows, each over the time since it last steered */
+internal void boids_tickPartitions(float dt);
+/* Moves every boid on by dt at its new velocity, then draws trails, pages and counts the tick */
+internal void boids_advance(float dt);
+/* Adds boid j to what boid i steers by, if it is within perception; returns whether it was */
+internal inline bool boids_see(boids_Steer *s, u32 i, u32 j, float perception2, float separation2);
+/* Gathers boid i's neighbors from the 27 grid cells around it */
+internal void boids_gatherGrid(u32 i, boids_Steer *s);
+/* Gathers boid i's neighbors from its neighbor list */
+internal void boids_gatherVerlet(u32 i, boids_Steer *s);
+/* Gathers boid i's k nearest neighbors, searching outward from its cell one shell of cells at a time */
+internal void boids_gatherNearest(u32 i, boids_Steer *s);
+/* Offers the boids of chunk c to boid i's nearest, passing over its sub-cells that are too far to matter */
+internal void boids_scanChunk(u32 i, u32 c, boids_Nearest *near);
+/* Adds boid j, d2 away, to the nearest found so far if it is nearer than the farthest of them */
+internal inline void boids_pushNearest(boids_Nearest *near, u32 j, float d2);
+/* Gets how far a position along one axis is from the span lo to hi on it: 0 inside */
+internal inline float boids_spanGap(float at, float lo, float hi);
+/* Sorts the boids of crowded chunks into sub-cells, so the topological mode's search costs the same however crowded */
+internal void boids_splitChunks(void);
+/* Gets which of a split chunk's sub-cells boid i is in, or nearest if it is outside the chunk */
+internal inline u32 boids_subCellOf(u32 i, const boids_Chunk *chunk, float cell_size);
+/* Gathers a fixed-size random sample of boid i's candidates from the grid, weighted to stand in for all of them */
+internal void boids_gatherSampled(u32 i, boids_Steer *s);
+/* Mixes two numbers into a well-spread one, the same every time */
+internal inline u32 boids_hash(u32 a, u32 b);
+/* Gathers every boid's neighbors at once, looking at each nearby pair of boids only once */
+internal void boids_gatherHalfShell(boids_Steer *steers);
+/* Adds boids i and j to what each other steers by, if they are within perception */
+internal inline void boids_seeBoth(boids_Steer *steers, u32 i, u32 j, float perception2, float separation2);
+/* Sums the grid's cells up into the aggregate pyramid; false if it couldn't be allocated */
+internal bool boids_buildPyramid(void);
+/* Finds a cell of a pyramid level by its coordinates, adding it empty if it isn't there; NULL if that failed */
+internal boids_Aggregate *boids_levelCell(boids_Level *level, const i32 coord[3]);
+/* Adds what boid i sees of the flock out to the far-field radius, shared with the rest of its cell */
+internal void boids_gatherFar(u32 i, boids_Steer *s);
+/* Sums the flock within the far-field radius of a point, from as few aggregates as will answer */
+internal void boids_queryFar(const vec3 at, boids_Far *far);
+/* Sets each chunk's level of detail from its distance to the camera */
+internal void boids_setTiers(void);
+/* Tracks how settled each chunk is, and puts quiet ones to sleep or wakes them when they or their neighbors stir */
+internal void boids_settle(void);
+/* Wakes every chunk within radius of center: something happened there */
+internal void boids_wake(const vec3 center, float radius);
+/* Decides whether boid i steers this tick, and how long for and by how many neighbors; false if it sits it out */
+internal bool boids_schedule(u32 i, boids_Steer *s, float dt);
+/* Turns what boid i has seen into its next velocity */
+internal void boids_steer(u32 i, boids_Steer *s, float dt);
+/* Checks that no boid has moved far enough since the neighbor lists were built for them to miss a neighbor */
+internal bool boids_verletValid(void);
+/* Rebuilds every boid's neighbor list; false if they couldn't be allocated */
+internal bool boids_buildVerlet(void);
+/* Shows or hides the flock's trails, creating them on first use */
+internal void boids_setTrails(bool visible);
+/* 
+Every BOIDS_PAGE_PERIOD ticks: moves the paged flocks on, pages back in those near the camera or the resident flock, 
+and pages out far islands while over budget
+*/
+internal void boids_page(void);
+/* Groups the grid's chunks into islands; returns how many */
+internal u32 boids_findIslands(void);
+/* Finds the chunk at the root of c's island, halving the path there */
+internal u32 boids_islandRoot(u32 *parent, u32 c);
+/* Orders islands farthest from the camera first */
+internal int boids_compareIslands(const void *a, const void *b);
+/* Writes the farthest islands to the file until the rest fit the budget, and takes them out of the flock */
+internal void boids_pageOut(u32 islands);
+/* Puts paged flock k's boids back in the flock, and forgets it */
+internal bool boids_pageIn(u32 k);
+/* Finds room for count records in the file, growing it if need be */
+internal bool boids_allocRecords(u32 count, boids_Extent *extent);
+/* Gives an extent's records back to the file, for later flocks to reuse */
+internal void boids_freeRecords(boids_Extent extent);
+/* Applies one of the quality levels to the simulation settings */
+internal void boids_setQuality(u32 level);
 
 /*
 Module functions
 */
 
-bool boids_world_init(void)
+bool boids_world_init(bool interactive, bool verbose)
 {
     // for image loading
     stbi_set_flip_vertically_on_load(true);
@@ -93,14 +517,64 @@ bool boids_world_init(void)
 
     player_inverted = true;
     
-    has_mouse = true;
-    wrm_input_setMouseState(has_mouse);
+    is_interactive = interactive;
+    is_verbose = verbose;
+    has_mouse = interactive;
+    if(is_interactive) wrm_input_setMouseState(has_mouse);
+
+    // every boid shares one small pyramid, pointing down +x
+    float positions[] = {
+         0.4f,  0.0f,  0.0f,
+        -0.2f,  0.15f, 0.0f,
+        -0.2f, -0.1f,  0.13f,
+        -0.2f, -0.1f, -0.13f,
+    };
+    float colors[] = {
+        1.0f, 0.9f, 0.4f, 1.0f,
+        0.9f, 0.5f, 0.2f, 1.0f,
+        0.8f, 0.4f, 0.2f, 1.0f,
+        0.8f, 0.4f, 0.2f, 1.0f,
+    };
+    u32 indices[] = {
+        0, 1, 2,
+        0, 2, 3,
+        0, 3, 1,
+        1, 3, 2,
+    };
+    wrm_Option_Handle mesh = wrm_render_createMesh(&(wrm_Mesh_Data){
+        .positions = positions,
+        .colors = colors,
+        .indices = indices,
+        .vtx_cnt = 4,
+        .tri_cnt = 4,
+    });
+    if(!mesh.exists) {
+        fprintf(stderr, "ERROR: World: failed to create boid mesh\n");
+        return false;
+    }
+    boid_mesh = mesh.Handle_val;
+
+    // the same flock every run, so benchmarks are comparable
+    srand(1);
+    tick_time = 0.0f;
+    boids_spawn(BOIDS_HOME, BOIDS_BOUNDS_RADIUS * 0.5f, BOIDS_INITIAL_COUNT);
+
+    // with nobody to press the key, a headless run draws them so their cost is measured
+    boids_setTrails(!is_interactive);
 
     return true;
 }
 
 void boids_world_update(float delta_time)
 {
+    if(!is_interactive) {
+        // one tick per frame: a benchmark does the same work however fast it draws
+        if(scheduler.budget_ms) boids_tickPartitions(BOIDS_TICK);
+        else boids_tick(BOIDS_TICK);
+        wrm_render_updateCamera(player_pitch, player_yaw, player_fov, 0.0f, player_pos);
+        return;
+    }
+
     // handle 'player' controls    
     boids_handlePlayerControls(delta_time);
         
@@ -113,6 +587,36 @@ void boids_world_update(float delta_time)
         wrm_input_setMouseState(has_mouse);
     }
 
+    wrm_Key t = wrm_input_getKey(BOIDS_TOGGLE_TRAILS);
+    if(has_mouse && t.down && !t.counter) {
+        boids_setTrails(!show_trails);
+    }
+
+    wrm_Key n = wrm_input_getKey(BOIDS_CYCLE_NEIGHBORS);
+    if(has_mouse && n.down && !n.counter) {
+        const char *names[BOIDS_NEIGHBOR_MODES] = { "grid", "verlet lists", "the nearest few", "a sample", "half the cells, pairwise" };
+        boids_world_setNeighborMode((neighbor_mode + 1) % BOIDS_NEIGHBOR_MODES);
+        if(is_verbose) printf("World: neighbors from %s\n", names[neighbor_mode]);
+    }
+
+    wrm_Key far = wrm_input_getKey(BOIDS_TOGGLE_FAR_FIELD);
+    if(has_mouse && far.down && !far.counter) {
+        boids_world_setFarField(!far_field);
+        if(is_verbose) printf("World: far-field flocking %s\n", far_field ? "on" : "off");
+    }
+
+    wrm_Key l = wrm_input_getKey(BOIDS_TOGGLE_LOD);
+    if(has_mouse && l.down && !l.counter) {
+        boids_world_setLOD(!lod);
+        if(is_verbose) printf("World: level of detail %s\n", lod ? "on" : "off");
+    }
+
+    wrm_Key z = wrm_input_getKey(BOIDS_TOGGLE_SLEEP);
+    if(has_mouse && z.down && !z.counter) {
+        boids_world_setSleeping(!sleeping);
+        if(is_verbose) printf("World: sleeping regions %s\n", sleeping ? "on" : "off");
+    }
+
 
     // could apply a cool fov effect if moving, based on the player's acceleration value
 
@@ -123,24 +627,204 @@ void boids_world_update(float delta_time)
             has_mouse = true;
             wrm_input_setMouseState(has_mouse);
         }
-        // spawn boids around cursor
+        else {
+            vec3 target;
+            boids_getTarget(target);
+            boids_spawn(target, BOIDS_SPAWN_RADIUS, BOIDS_SPAWN_COUNT);
+        }
     }
-    if(m.right_button && !m.right_counter) {
-        // remove boids around cursor
+    if(m.right_button && !m.right_counter && has_mouse) {
+        vec3 target;
+        boids_getTarget(target);
+        boids_remove(target, BOIDS_REMOVE_RADIUS);
     }
-    
-    
-    // chunk the total area
 
-    // update all boids based on the boids in their vicinity
+    // update all boids based on the boids in their vicinity: as much as fits in the budget, or at a fixed rate
+    if(scheduler.budget_ms) {
+        boids_tickPartitions(glm_min(delta_time, BOIDS_MAX_TICKS * BOIDS_TICK));
+        wrm_render_updateCamera(player_pitch, player_yaw, player_fov, 0.0f, player_pos);
+        return;
+    }
+    tick_time += delta_time;
+    u32 ticks = 0;
+    while(tick_time >= BOIDS_TICK && ticks < BOIDS_MAX_TICKS) {
+        boids_tick(BOIDS_TICK);
+        tick_time -= BOIDS_TICK;
+        ticks++;
+    }
+    if(ticks == BOIDS_MAX_TICKS) tick_time = 0.0f; // fell behind: drop the backlog rather than chase it
 
     // update render data
     wrm_render_updateCamera(player_pitch, player_yaw, player_fov, 0.0f, player_pos);
 }
 
+u32 boids_world_getCount(void)
+{
+    return the_boids.count;
+}
+
+void boids_world_setGovernor(float budget_ms, bool log)
+{
+    governor = (boids_Governor){
+        .budget_ms = budget_ms > 0.0f ? budget_ms : 0.0f,
+        .log = log,
+        .level = governor.level,
+        .update_ms = budget_ms,
+    };
+    // with no governor, the world runs at full quality
+    if(!governor.budget_ms && governor.level) boids_setQuality(0);
+}
+
+void boids_world_govern(float update_ms)
+{
+    boids_Governor *g = &governor;
+    if(!g->budget_ms) return;
+
+    g->update_ms += BOIDS_GOVERNOR_SMOOTHING * (update_ms - g->update_ms);
+    g->frames++;
+
+    u32 level = g->level;
+    if(g->update_ms > g->budget_ms && g->frames >= BOIDS_GOVERNOR_DROP_FRAMES && level + 1 < BOIDS_QUALITY_LEVELS) {
+        level++;
+    }
+    else if(g->update_ms < g->budget_ms * BOIDS_GOVERNOR_HEADROOM && g->frames >= BOIDS_GOVERNOR_CLIMB_FRAMES && level > 0) {
+        level--;
+    }
+    if(level == g->level) return;
+
+    if(g->log) {
+        const boids_Quality *q = BOIDS_QUALITY + level;
+        printf("World: updates at %.2fms against a %.2fms budget: quality %u -> %u (%.0fHz ticks, %u neighbors, %u trail samples, %.0f%% LOD distances)\n",
+            g->update_ms, g->budget_ms, g->level, level, 1.0f / q->tick, q->max_neighbors, q->trail_length, 100.0f * q->lod_scale);
+    }
+    boids_setQuality(level);
+}
+
+void boids_world_setNeighborMode(boids_Neighbor_Mode mode)
+{
+    if(mode >= BOIDS_NEIGHBOR_MODES) return;
+    neighbor_mode = mode;
+    verlet.stale = true;
+}
+
+void boids_world_setFarField(bool enabled)
+{
+    far_field = enabled;
+}
+
+bool boids_world_setPaging(const char *path, size_t budget_bytes)
+{
+    boids_Pager *p = &pager;
+
+    // everything comes back before the file goes, or a new budget is set
+    while(p->paged.len) {
+        if(!boids_pageIn(p->paged.len - 1)) return false;
+    }
+    if(p->budget) {
+        if(p->records) munmap(p->records, (size_t)p->cap * sizeof(boids_Record));
+        close(p->fd);
+        p->records = NULL;
+        p->cap = 0;
+        p->end = 0;
+        p->gaps.len = 0;
+        p->budget = 0;
+    }
+    if(!path || !budget_bytes) return true;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if(fd < 0) {
+        fprintf(stderr, "ERROR: World: failed to open page file %s\n", path);
+        return false;
+    }
+    // scratch for this run only: gone from the directory now, and from the disk once closed
+    unlink(path);
+
+    p->fd = fd;
+    size_t boids = budget_bytes / BOIDS_RESIDENT_BYTES;
+    p->budget = boids > UINT32_MAX ? UINT32_MAX : boids ? (u32)boids : 1;
+    return true;
+}
+
+void boids_world_setTimeBudget(float budget_ms, bool log)
+{
+    scheduler.budget_ms = budget_ms > 0.0f ? budget_ms : 0.0f;
+    scheduler.log = log;
+    scheduler.stats = (boids_Staleness){0};
+    scheduler.partitions = 0;
+    // back on fixed ticks, start from a clean slate rather than a backlog
+    tick_time = 0.0f;
+}
+
+void boids_world_getStaleness(boids_Staleness *stats)
+{
+    *stats = scheduler.stats;
+}
+
+void boids_world_setLOD(bool enabled)
+{
+    lod = enabled;
+}
+
+void boids_world_setSleeping(bool enabled)
+{
+    sleeping = enabled;
+    // nothing sleeps on from before: chunks have to be quiet a while again
+    boids_Grid *g = &the_grid;
+    for(u32 c = 0; c < g->chunks.cap; c++) {
+        if(!g->chunks.is_used[c]) continue;
+        wrm_Pool_dataAs(g->chunks, boids_Chunk)[c].asleep = false;
+        wrm_Pool_dataAs(g->chunks, boids_Chunk)[c].quiet_ticks = 0;
+    }
+}
+
 void boids_world_quit(void)
 {
+    free(the_boids.pos);
+    free(the_boids.vel);
+    free(the_boids.next_vel);
+    free(the_boids.steered);
+    free(the_boids.models);
+    the_boids = (boids_Flock){0};
+
+    wrm_Pool_delete(&the_grid.chunks);
+    free(the_grid.map.slots);
+    free(the_grid.cell_boids);
+    free(the_grid.boid_cell);
+    free(the_grid.sub_start);
+    free(the_grid.scratch);
+    the_grid = (boids_Grid){0};
 
+    free(verlet.start);
+    free(verlet.ref_pos);
+    free(verlet.boids);
+    verlet = (boids_Verlet){0};
+
+    free(steers);
+    steers = NULL;
+    steer_cap = 0;
+
+    free(scheduler.steered);
+    scheduler = (boids_Scheduler){0};
+
+    for(u32 l = 0; l < BOIDS_PYRAMID_MAX_LEVELS; l++) {
+        free(pyramid.level[l].map.slots);
+        free(pyramid.level[l].cells);
+    }
+    free(pyramid.far);
+    pyramid = (boids_Pyramid){0};
+
+    // paged flocks go down with the file
+    if(pager.budget) {
+        if(pager.records) munmap(pager.records, (size_t)pager.cap * sizeof(boids_Record));
+        close(pager.fd);
+    }
+    free(pager.gaps.data);
+    free(pager.paged.data);
+    free(pager.chunk_island);
+    free(pager.islands);
+    free(pager.order);
+    free(pager.evicted);
+    pager = (boids_Pager){0};
 }
 
 
@@ -275,5 +959,1687 @@ internal void boids_handlePlayerControls(float delta_time)
     }
 }
 
+internal void boids_getTarget(vec3 target)
+{
+    vec3 facing = {
+        cosf(glm_rad(player_yaw)) * cosf(glm_rad(player_pitch)),
+        sinf(glm_rad(player_pitch)),
+        sinf(glm_rad(player_yaw)) * cosf(glm_rad(player_pitch))
+    };
+    glm_vec3_scale(facing, BOIDS_SPAWN_DISTANCE, facing);
+    glm_vec3_add(player_pos, facing, target);
+}
+
+internal float boids_random(float min, float max)
+{
+    return min + (max - min) * ((float)rand() / (float)RAND_MAX);
+}
+
+internal void boids_spawn(const vec3 center, float radius, u32 count)
+{
+    boids_Flock *f = &the_boids;
+    if(!boids_reserve(count)) return;
+    // the boids around have company to steer around
+    boids_wake(center, radius + BOIDS_PERCEPTION);
+
+    // new boids have no neighbor lists yet
+    verlet.stale = true;
+    for(u32 n = 0; n < count; n++) {
+        u32 i = f->count;
+
+        // a random point in the sphere: reject the cube's corners
+        vec3 offset;
+        do {
+            offset[0] = boids_random(-1.0f, 1.0f);
+            offset[1] = boids_random(-1.0f, 1.0f);
+            offset[2] = boids_random(-1.0f, 1.0f);
+        } while(glm_vec3_norm2(offset) > 1.0f);
+        glm_vec3_scale(offset, radius, offset);
+        glm_vec3_add((float*)center, offset, f->pos[i]);
+
+        vec3 heading = { boids_random(-1.0f, 1.0f), boids_random(-0.3f, 0.3f), boids_random(-1.0f, 1.0f) };
+        glm_vec3_normalize(heading);
+        glm_vec3_scale(heading, boids_random(BOIDS_MIN_SPEED, BOIDS_MAX_SPEED), f->vel[i]);
+        // staggered, so far boids don't all steer on the same tick
+        f->steered[i] = ticks_run - 1 - i % (1u << (BOIDS_LOD_TIERS - 1));
+
+        if(!boids_createModel(i)) return;
+        f->count++;
+    }
+}
+
+internal bool boids_reserve(u32 count)
+{
+    boids_Flock *f = &the_boids;
+    if(f->count + count <= f->cap) return true;
+
+    u32 cap = f->cap ? f->cap : BOIDS_SPAWN_COUNT;
+    while(cap < f->count + count) cap *= 2;
+
+    vec3 *pos = realloc(f->pos, cap * sizeof(vec3));
+    if(pos) f->pos = pos;
+    vec3 *vel = realloc(f->vel, cap * sizeof(vec3));
+    if(vel) f->vel = vel;
+    vec3 *next_vel = realloc(f->next_vel, cap * sizeof(vec3));
+    if(next_vel) f->next_vel = next_vel;
+    u32 *steered = realloc(f->steered, cap * sizeof(u32));
+    if(steered) f->steered = steered;
+    wrm_Handle *models = realloc(f->models, cap * sizeof(wrm_Handle));
+    if(models) f->models = models;
+
+    if(!pos || !vel || !next_vel || !steered || !models) {
+        fprintf(stderr, "ERROR: World: failed to allocate space for %u boids\n", cap);
+        return false;
+    }
+    f->cap = cap;
+    return true;
+}
+
+internal bool boids_createModel(u32 i)
+{
+    wrm_Model data = {
+        .scale = { 1.0f, 1.0f, 1.0f },
+        .mesh = boid_mesh,
+        .shader = wrm_shader_defaults.color,
+        .is_visible = true,
+    };
+    glm_vec3_copy(the_boids.pos[i], data.pos);
+
+    wrm_Option_Handle model = wrm_render_createModel(&data, false);
+    if(!model.exists) {
+        fprintf(stderr, "ERROR: World: failed to create boid model\n");
+        return false;
+    }
+    the_boids.models[i] = model.Handle_val;
+    return true;
+}
+
+internal void boids_remove(const vec3 center, float radius)
+{
+    boids_Flock *f = &the_boids;
+    float r2 = radius * radius;
+    // the boids around lose neighbors they were steering by
+    boids_wake(center, radius + BOIDS_PERCEPTION);
+
+    for(u32 i = 0; i < f->count; ) {
+        if(glm_vec3_distance2(f->pos[i], (float*)center) > r2) {
+            i++;
+            continue;
+        }
+
+        wrm_render_deleteModel(f->models[i]);
+
+        // swap the last boid into the hole, and check it in turn
+        u32 last = --f->count;
+        glm_vec3_copy(f->pos[last], f->pos[i]);
+        glm_vec3_copy(f->vel[last], f->vel[i]);
+        f->steered[i] = f->steered[last];
+        f->models[i] = f->models[last];
+        verlet.stale = true;
+    }
+}
+
+internal void boids_buildGrid(float cell_size)
+{
+    boids_Flock *f = &the_boids;
+    boids_Grid *g = &the_grid;
+    if(!f->count) return;
+
+    // cells at least as wide as the search radius, so neighbors are always within the 27 surrounding cells;
+    // a new width makes every chunk's coordinates wrong, so they all go back to the pool
+    if(cell_size != g->cell_size) {
+        for(u32 c = 0; c < g->chunks.cap; c++) {
+            if(g->chunks.is_used[c]) wrm_Pool_freeSlot(&g->chunks, c);
+        }
+        boids_mapClear(&g->map);
+        g->cell_size = cell_size;
+    }
+    if(!g->chunks.data) wrm_Pool_init(&g->chunks, BOIDS_CHUNK_POOL, sizeof(boids_Chunk));
+
+    // sized to the flock's capacity so they only grow as often as the flock does
+    u32 *cell_boids = realloc(g->cell_boids, f->cap * sizeof(u32));
+    if(cell_boids) g->cell_boids = cell_boids;
+    u32 *boid_cell = realloc(g->boid_cell, f->cap * sizeof(u32));
+    if(boid_cell) g->boid_cell = boid_cell;
+    if(!g->chunks.data || !cell_boids || !boid_cell) {
+        fprintf(stderr, "ERROR: World: failed to allocate grid entries for %u boids\n", f->count);
+        g->cell_cnt = 0;
+        return;
+    }
+
+    for(u32 c = 0; c < g->chunks.cap; c++) {
+        if(!g->chunks.is_used[c]) continue;
+        wrm_Pool_dataAs(g->chunks, boids_Chunk)[c].count = 0;
+        wrm_Pool_dataAs(g->chunks, boids_Chunk)[c].entered = 0;
+        wrm_Pool_dataAs(g->chunks, boids_Chunk)[c].split = 1;
+    }
+
+    // count each chunk, making chunks for boids that moved into empty space
+    for(u32 i = 0; i < f->count; i++) {
+        i32 coord[3];
+        boids_coordOf(f->pos[i], g->cell_size, coord);
+        u32 c = boids_mapFind(&g->map, coord);
+        if(c == BOIDS_NONE) {
+            wrm_Option_Handle chunk = wrm_Pool_getSlot(&g->chunks);
+            if(!chunk.exists || !boids_mapInsert(&g->map, coord, chunk.Handle_val)) {
+                fprintf(stderr, "ERROR: World: failed to allocate a chunk\n");
+                if(chunk.exists) wrm_Pool_freeSlot(&g->chunks, chunk.Handle_val);
+                g->cell_cnt = 0;
+                return;
+            }
+            c = chunk.Handle_val;
+            boids_Chunk *fresh = wrm_Pool_dataAs(g->chunks, boids_Chunk) + c;
+            memcpy(fresh->coord, coord, sizeof(coord));
+            fresh->count = 0;
+            fresh->tier = 0;
+            fresh->entered = 0;
+            fresh->activity = 0.0f;
+            fresh->quiet_ticks = 0;
+            fresh->asleep = false;
+            fresh->split = 1;
+        }
+        // boids added, removed or reordered since the last sort count as having come in: it only ever wakes chunks
+        if(g->boid_cell[i] != c) wrm_Pool_dataAs(g->chunks, boids_Chunk)[c].entered++;
+        g->boid_cell[i] = c;
+        wrm_Pool_dataAs(g->chunks, boids_Chunk)[c].count++;
+    }
+
+    // recycle the chunks every boid has left, and lay the rest out end to end
+    boids_Chunk *chunks = wrm_Pool_dataAs(g->chunks, boids_Chunk);
+    u32 start = 0;
+    g->cell_cnt = 0;
+    for(u32 c = 0; c < g->chunks.cap; c++) {
+        if(!g->chunks.is_used[c]) continue;
+        if(!chunks[c].count) {
+            boids_mapRemove(&g->map, chunks[c].coord);
+            wrm_Pool_freeSlot(&g->chunks, c);
+            continue;
+        }
+        // the running end: filling below counts back down to the start
+        start += chunks[c].count;
+        chunks[c].start = start;
+        g->cell_cnt++;
+    }
+    for(u32 i = f->count; i-- > 0; ) {
+        g->cell_boids[--chunks[g->boid_cell[i]].start] = i;
+    }
+    g->boid_cnt = f->count;
+
+    // who each chunk's neighbors are, once per chunk rather than once per boid
+    for(u32 c = 0; c < g->chunks.cap; c++) {
+        if(!g->chunks.is_used[c]) continue;
+        u32 n = 0;
+        for(i32 z = -1; z <= 1; z++) {
+            for(i32 y = -1; y <= 1; y++) {
+                for(i32 x = -1; x <= 1; x++) {
+                    i32 at[3] = { chunks[c].coord[0] + x, chunks[c].coord[1] + y, chunks[c].coord[2] + z };
+                    chunks[c].around[n++] = boids_mapFind(&g->map, at);
+                }
+            }
+        }
+    }
+}
+
+internal void boids_coordOf(const vec3 pos, float cell_size, i32 coord[3])
+{
+    for(u32 a = 0; a < 3; a++) coord[a] = (i32)floorf(pos[a] / cell_size);
+}
+
+internal inline i32 boids_halve(i32 n)
+{
+    // rounds down, for negative coordinates too
+    return (n - (n < 0)) / 2;
+}
+
+internal u32 boids_mapFind(const boids_Map *m, const i32 key[3])
+{
+    if(!m->count) return BOIDS_NONE;
+    u32 mask = m->cap - 1;
+    for(u32 s = boids_mapHash(key) & mask; ; s = (s + 1) & mask) {
+        const boids_Map_Slot *slot = m->slots + s;
+        if(slot->value == BOIDS_NONE) return BOIDS_NONE;
+        if(slot->key[0] == key[0] && slot->key[1] == key[1] && slot->key[2] == key[2]) return slot->value;
+    }
+}
+
+internal bool boids_mapInsert(boids_Map *m, const i32 key[3], u32 value)
+{
+    // at most half full, so probes stay short
+    if(2 * (m->count + 1) > m->cap) {
+        u32 cap = m->cap ? 2 * m->cap : BOIDS_MAP_SLOTS;
+        boids_Map_Slot *slots = malloc(cap * sizeof(boids_Map_Slot));
+        if(!slots) return false;
+        for(u32 s = 0; s < cap; s++) slots[s].value = BOIDS_NONE;
+
+        boids_Map grown = { .count = 0, .cap = cap, .slots = slots };
+        for(u32 s = 0; s < m->cap; s++) {
+            if(m->slots[s].value != BOIDS_NONE) boids_mapInsert(&grown, m->slots[s].key, m->slots[s].value);
+        }
+        free(m->slots);
+        *m = grown;
+    }
+
+    u32 mask = m->cap - 1;
+    u32 s = boids_mapHash(key) & mask;
+    while(m->slots[s].value != BOIDS_NONE) s = (s + 1) & mask;
+    memcpy(m->slots[s].key, key, sizeof(m->slots[s].key));
+    m->slots[s].value = value;
+    m->count++;
+    return true;
+}
+
+internal void boids_mapRemove(boids_Map *m, const i32 key[3])
+{
+    if(!m->count) return;
+    u32 mask = m->cap - 1;
+    u32 hole = boids_mapHash(key) & mask;
+    for(;; hole = (hole + 1) & mask) {
+        boids_Map_Slot *slot = m->slots + hole;
+        if(slot->value == BOIDS_NONE) return;
+        if(slot->key[0] == key[0] && slot->key[1] == key[1] && slot->key[2] == key[2]) break;
+    }
+
+    // no tombstones: pull back any later entry of the run that would no longer be found past the hole
+    for(u32 s = (hole + 1) & mask; m->slots[s].value != BOIDS_NONE; s = (s + 1) & mask) {
+        u32 home = boids_mapHash(m->slots[s].key) & mask;
+        bool stays = hole < s ? (home > hole && home <= s) : (home > hole || home <= s);
+        if(stays) continue;
+        m->slots[hole] = m->slots[s];
+        hole = s;
+    }
+    m->slots[hole].value = BOIDS_NONE;
+    m->count--;
+}
+
+internal void boids_mapClear(boids_Map *m)
+{
+    for(u32 s = 0; s < m->cap; s++) m->slots[s].value = BOIDS_NONE;
+    m->count = 0;
+}
+
+internal inline u32 boids_mapHash(const i32 key[3])
+{
+    return boids_hash(boids_hash((u32)key[0], (u32)key[1]), (u32)key[2]);
+}
+
+internal void boids_tick(float dt)
+{
+    boids_Flock *f = &the_boids;
+    if(!f->count) {
+        // paged flocks may still be drifting back into view
+        boids_page();
+        ticks_run++;
+        return;
+    }
+
+    // the lists stand in for the grid until boids have moved far enough to need new ones
+    bool use_lists = neighbor_mode == BOIDS_NEIGHBORS_VERLET && (boids_verletValid() || boids_buildVerlet());
+    if(!use_lists) {
+        boids_buildGrid(BOIDS_PERCEPTION);
+        if(!the_grid.cell_cnt) return;
+        if(neighbor_mode == BOIDS_NEIGHBORS_KNN) boids_splitChunks();
+    }
+
+    bool use_far = far_field && boids_buildPyramid();
+    // the lists skip sorting, but the last sort's chunks still hold every boid, near enough where it is now
+    if(lod) boids_setTiers();
+    if(sleeping) boids_settle();
+
+    if(neighbor_mode == BOIDS_NEIGHBORS_HALF_SHELL) {
+        // pairs are shared, so every boid's sums are gathered before any of them steers
+        if(f->count > steer_cap) {
+            boids_Steer *grown = realloc(steers, f->cap * sizeof(boids_Steer));
+            if(!grown) {
+                fprintf(stderr, "ERROR: World: failed to allocate steering sums for %u boids\n", f->count);
+                return;
+            }
+            steers = grown;
+            steer_cap = f->cap;
+        }
+        memset(steers, 0, f->count * sizeof(boids_Steer));
+        for(u32 i = 0; i < f->count; i++) boids_schedule(i, steers + i, dt);
+        boids_gatherHalfShell(steers);
+        for(u32 i = 0; i < f->count; i++) {
+            if(!steers[i].dt) {
+                glm_vec3_copy(f->vel[i], f->next_vel[i]);
+                continue;
+            }
+            if(use_far) boids_gatherFar(i, steers + i);
+            boids_steer(i, steers + i, steers[i].dt);
+        }
+    }
+    else {
+        for(u32 i = 0; i < f->count; i++) {
+            boids_Steer s = {0};
+            // sitting the tick out, a boid keeps its heading: it still moves every tick, so it never jumps
+            if(!boids_schedule(i, &s, dt)) {
+                glm_vec3_copy(f->vel[i], f->next_vel[i]);
+                continue;
+            }
+            if(use_lists) boids_gatherVerlet(i, &s);
+            else if(neighbor_mode == BOIDS_NEIGHBORS_KNN) boids_gatherNearest(i, &s);
+            else if(neighbor_mode == BOIDS_NEIGHBORS_SAMPLED) boids_gatherSampled(i, &s);
+            else boids_gatherGrid(i, &s);
+            if(use_far) boids_gatherFar(i, &s);
+            boids_steer(i, &s, s.dt);
+        }
+    }
+
+    boids_advance(dt);
+}
+
+internal void boids_tickPartitions(float dt)
+{
+    boids_Flock *f = &the_boids;
+    boids_Scheduler *sc = &scheduler;
+    u64 start = SDL_GetPerformanceCounter();
+    double per_ms = (double)SDL_GetPerformanceFrequency() / 1000.0;
+
+    sc->time += dt;
+    sc->stats = (boids_Staleness){0};
+    if(!f->count) {
+        sc->partitions = 0;
+        boids_page();
+        ticks_run++;
+        return;
+    }
+
+    bool use_lists = neighbor_mode == BOIDS_NEIGHBORS_VERLET && (boids_verletValid() || boids_buildVerlet());
+    if(!use_lists) {
+        boids_buildGrid(BOIDS_PERCEPTION);
+        if(!the_grid.cell_cnt) return;
+        if(neighbor_mode == BOIDS_NEIGHBORS_KNN) boids_splitChunks();
+    }
+    bool use_far = far_field && boids_buildPyramid();
+    if(sleeping) boids_settle();
+    boids_Chunk *chunks = wrm_Pool_dataAs(the_grid.chunks, boids_Chunk);
+
+    u32 partitions = (f->count + BOIDS_PARTITION - 1) / BOIDS_PARTITION;
+    if(partitions > sc->cap) {
+        double *steered = realloc(sc->steered, partitions * sizeof(double));
+        if(!steered) {
+            fprintf(stderr, "ERROR: World: failed to allocate %u partitions\n", partitions);
+            return;
+        }
+        sc->steered = steered;
+        sc->cap = partitions;
+    }
+    // new partitions are as fresh as the boids in them, including ones the flock shrank out of and has grown back into
+    for(u32 p = sc->partitions; p < partitions; p++) sc->steered[p] = sc->time - dt;
+    sc->partitions = partitions;
+    // and a shrunk flock may have taken the next partition with it
+    sc->next %= partitions;
+
+    // boids not steered this time keep their heading
+    memcpy(f->next_vel, f->vel, f->count * sizeof(vec3));
+
+    // at least one partition, so the flock can't freeze however slow the machine; the rest as time allows,
+    // leaving room to move everyone afterwards
+    u64 deadline = start + (u64)(glm_max(sc->budget_ms - sc->move_ms, 0.0) * per_ms);
+    u32 steered = 0;
+    do {
+        u32 p = sc->next;
+        sc->next = (p + 1) % partitions;
+        // a partition long behind catches up by no more than the fixed ticks would in one update
+        float elapsed = glm_min(sc->time - sc->steered[p], BOIDS_MAX_TICKS * BOIDS_TICK);
+        sc->steered[p] = sc->time;
+
+        u32 end = glm_imin((p + 1) * BOIDS_PARTITION, f->count);
+        for(u32 i = p * BOIDS_PARTITION; i < end; i++) {
+            if(sleeping && chunks[the_grid.boid_cell[i]].asleep) continue;
+            boids_Steer s = { .max_neighbors = BOIDS_MAX_NEIGHBORS, .dt = elapsed };
+            // half-shell pairs span partitions: scan the grid instead
+            if(use_lists) boids_gatherVerlet(i, &s);
+            else if(neighbor_mode == BOIDS_NEIGHBORS_KNN) boids_gatherNearest(i, &s);
+            else if(neighbor_mode == BOIDS_NEIGHBORS_SAMPLED) boids_gatherSampled(i, &s);
+            else boids_gatherGrid(i, &s);
+            if(use_far) boids_gatherFar(i, &s);
+            boids_steer(i, &s, elapsed);
+        }
+        steered++;
+    } while(steered < partitions && SDL_GetPerformanceCounter() < deadline);
+
+    u64 moving = SDL_GetPerformanceCounter();
+    boids_advance(dt);
+    sc->move_ms = (double)(SDL_GetPerformanceCounter() - moving) / per_ms;
+
+    // how far behind each partition's steering now is
+    boids_Staleness *st = &sc->stats;
+    st->partitions = partitions;
+    st->steered = steered;
+    for(u32 p = 0; p < partitions; p++) {
+        float stale = (float)(sc->time - sc->steered[p]) * 1000.0f;
+        st->mean_ms += stale;
+        st->max_ms = glm_max(st->max_ms, stale);
+    }
+    st->mean_ms /= partitions;
+
+    if(!sc->log) return;
+    sc->log_updates++;
+    sc->log_steered += steered;
+    sc->log_max_ms = glm_max(sc->log_max_ms, st->max_ms);
+    if(sc->time - sc->log_time < BOIDS_LOG_PERIOD) return;
+    printf("World: steered %.1f of %u partitions per update, %.1fms stale on average, %.1fms at worst\n",
+        (float)sc->log_steered / sc->log_updates, partitions, st->mean_ms, sc->log_max_ms);
+    sc->log_updates = 0;
+    sc->log_steered = 0;
+    sc->log_max_ms = 0.0f;
+    sc->log_time = sc->time;
+}
+
+internal void boids_advance(float dt)
+{
+    boids_Flock *f = &the_boids;
+
+    for(u32 i = 0; i < f->count; i++) {
+        float clamped = glm_vec3_norm(f->next_vel[i]);
+        if(clamped > BOIDS_MAX_SPEED) glm_vec3_scale(f->next_vel[i], BOIDS_MAX_SPEED / clamped, f->next_vel[i]);
+        else if(clamped < BOIDS_MIN_SPEED && clamped > 0.0f) glm_vec3_scale(f->next_vel[i], BOIDS_MIN_SPEED / clamped, f->next_vel[i]);
+
+        glm_vec3_copy(f->next_vel[i], f->vel[i]);
+        glm_vec3_muladds(f->vel[i], dt, f->pos[i]);
+
+        // the mesh points down +x: turn it up or down (about z), then around (about y)
+        float speed = glm_vec3_norm(f->vel[i]);
+        vec3 rot = {
+            0.0f,
+            glm_deg(atan2f(-f->vel[i][2], f->vel[i][0])),
+            speed > 0.0f ? glm_deg(asinf(f->vel[i][1] / speed)) : 0.0f,
+        };
+        wrm_render_updateModelTransform(f->models[i], f->pos[i], rot, (vec3){1.0f, 1.0f, 1.0f});
+    }
+
+    if(trails.exists) {
+        wrm_render_pushTrails(trails.Handle_val, (const float*)f->pos, f->count);
+    }
+    boids_page();
+    ticks_run++;
+}
+
+internal inline bool boids_see(boids_Steer *s, u32 i, u32 j, float perception2, float separation2)
+{
+    boids_Flock *f = &the_boids;
+
+    vec3 away;
+    glm_vec3_sub(f->pos[i], f->pos[j], away);
+    float d2 = glm_vec3_norm2(away);
+    if(d2 > perception2) return false;
+
+    if(d2 < separation2 && d2 > 0.0f) {
+        // closer neighbors push harder
+        glm_vec3_muladds(away, 1.0f / d2, s->separation);
+    }
+    glm_vec3_add(s->alignment, f->vel[j], s->alignment);
+    glm_vec3_add(s->cohesion, f->pos[j], s->cohesion);
+    s->neighbors++;
+    return true;
+}
+
+internal void boids_gatherGrid(u32 i, boids_Steer *s)
+{
+    boids_Grid *g = &the_grid;
+    boids_Chunk *chunks = wrm_Pool_dataAs(g->chunks, boids_Chunk);
+    float perception2 = BOIDS_PERCEPTION * BOIDS_PERCEPTION;
+    float separation2 = BOIDS_SEPARATION * BOIDS_SEPARATION;
+
+    const u32 *around = chunks[g->boid_cell[i]].around;
+    for(u32 n = 0; n < 27 && s->neighbors < s->max_neighbors; n++) {
+        if(around[n] == BOIDS_NONE) continue;
+        boids_Chunk *c = chunks + around[n];
+        for(u32 k = c->start; k < c->start + c->count && s->neighbors < s->max_neighbors; k++) {
+            u32 j = g->cell_boids[k];
+            if(j != i) boids_see(s, i, j, perception2, separation2);
+        }
+    }
+}
+
+internal void boids_gatherVerlet(u32 i, boids_Steer *s)
+{
+    boids_Verlet *v = &verlet;
+    float perception2 = BOIDS_PERCEPTION * BOIDS_PERCEPTION;
+    float separation2 = BOIDS_SEPARATION * BOIDS_SEPARATION;
+
+    for(u32 k = v->start[i]; k < v->start[i + 1] && s->neighbors < s->max_neighbors; k++) {
+        boids_see(s, i, v->boids[k], perception2, separation2);
+    }
+}
 
+internal void boids_gatherNearest(u32 i, boids_Steer *s)
+{
+    boids_Flock *f = &the_boids;
+    boids_Grid *g = &the_grid;
+    boids_Chunk *chunks = wrm_Pool_dataAs(g->chunks, boids_Chunk);
+    boids_Nearest near = { .k = glm_imin(glm_imin(BOIDS_KNN_K, s->max_neighbors), BOIDS_KNN_MAX_K) };
 
+    i32 *c = chunks[g->boid_cell[i]].coord;
+
+    // how far the boid is from the nearest face of its own cell: every cell on a shell is at least
+    // that much plus the shell's width, less one cell, away
+    float inset = g->cell_size;
+    for(u32 a = 0; a < 3; a++) {
+        float lo = glm_clamp(f->pos[i][a] - c[a] * g->cell_size, 0.0f, g->cell_size);
+        inset = glm_min(inset, glm_min(lo, g->cell_size - lo));
+    }
+
+    // the cells s away from the boid's own, in ever larger shells, until nothing further out can be nearer;
+    // once k are found, whole planes, rows and cells farther than the farthest of them are passed over
+    for(i32 shell = 0; shell <= (i32)BOIDS_KNN_MAX_SHELLS; shell++) {
+        for(i32 z = c[2] - shell; z <= c[2] + shell; z++) {
+            float gz = boids_spanGap(f->pos[i][2], z * g->cell_size, (z + 1) * g->cell_size);
+            float gap2_z = gz * gz;
+            if(near.found == near.k && gap2_z >= near.d2[0]) continue;
+
+            for(i32 y = c[1] - shell; y <= c[1] + shell; y++) {
+                float gy = boids_spanGap(f->pos[i][1], y * g->cell_size, (y + 1) * g->cell_size);
+                float gap2_y = gap2_z + gy * gy;
+                if(near.found == near.k && gap2_y >= near.d2[0]) continue;
+
+                // inside the shell's faces only its two ends in x are on the shell
+                bool face = abs(z - c[2]) == shell || abs(y - c[1]) == shell;
+                i32 step = face || !shell ? 1 : 2 * shell;
+                for(i32 x = c[0] - shell; x <= c[0] + shell; x += step) {
+                    float gx = boids_spanGap(f->pos[i][0], x * g->cell_size, (x + 1) * g->cell_size);
+                    if(near.found == near.k && gap2_y + gx * gx >= near.d2[0]) continue;
+
+                    // the chunks next door are already known; further out they have to be looked up
+                    u32 cc;
+                    if(shell <= 1) cc = chunks[g->boid_cell[i]].around[((z - c[2] + 1) * 3 + (y - c[1] + 1)) * 3 + (x - c[0] + 1)];
+                    else cc = boids_mapFind(&g->map, (i32[3]){ x, y, z });
+                    if(cc != BOIDS_NONE) boids_scanChunk(i, cc, &near);
+                }
+            }
+        }
+
+        float reach = shell * g->cell_size + inset;
+        if(near.found == near.k && near.d2[0] <= reach * reach) break;
+    }
+
+    // topological: the k nearest count whatever their distance
+    float separation2 = BOIDS_SEPARATION * BOIDS_SEPARATION;
+    for(u32 n = 0; n < near.found; n++) {
+        boids_see(s, i, near.boid[n], INFINITY, separation2);
+    }
+}
+
+internal void boids_scanChunk(u32 i, u32 c, boids_Nearest *near)
+{
+    boids_Flock *f = &the_boids;
+    boids_Grid *g = &the_grid;
+    boids_Chunk *chunk = wrm_Pool_dataAs(g->chunks, boids_Chunk) + c;
+
+    u32 split = chunk->split;
+    if(split == 1) {
+        for(u32 n = chunk->start; n < chunk->start + chunk->count; n++) {
+            u32 j = g->cell_boids[n];
+            if(j != i) boids_pushNearest(near, j, glm_vec3_distance2(f->pos[i], f->pos[j]));
+        }
+        return;
+    }
+
+    // where the boid is from the chunk's low corner
+    float width = g->cell_size / split;
+    float at[3];
+    for(u32 a = 0; a < 3; a++) at[a] = f->pos[i][a] - chunk->coord[a] * g->cell_size;
+    const u32 *start = g->sub_start + chunk->sub;
+
+    // the sub-cell nearest the boid first: the boids in it fill the heap with near ones, so most of the rest can be passed over
+    u32 first = boids_subCellOf(i, chunk, g->cell_size);
+    for(u32 n = start[first]; n < start[first + 1]; n++) {
+        u32 j = g->cell_boids[n];
+        if(j != i) boids_pushNearest(near, j, glm_vec3_distance2(f->pos[i], f->pos[j]));
+    }
+
+    for(u32 z = 0; z < split; z++) {
+        float gz = boids_spanGap(at[2], z * width, (z + 1) * width);
+        float gap2_z = gz * gz;
+        if(near->found == near->k && gap2_z >= near->d2[0]) continue;
+
+        for(u32 y = 0; y < split; y++) {
+            float gy = boids_spanGap(at[1], y * width, (y + 1) * width);
+            float gap2_y = gap2_z + gy * gy;
+            if(near->found == near->k && gap2_y >= near->d2[0]) continue;
+
+            for(u32 x = 0; x < split; x++) {
+                u32 sub = (z * split + y) * split + x;
+                float gx = boids_spanGap(at[0], x * width, (x + 1) * width);
+                if(sub == first || (near->found == near->k && gap2_y + gx * gx >= near->d2[0])) continue;
+                for(u32 n = start[sub]; n < start[sub + 1]; n++) {
+                    u32 j = g->cell_boids[n];
+                    if(j != i) boids_pushNearest(near, j, glm_vec3_distance2(f->pos[i], f->pos[j]));
+                }
+            }
+        }
+    }
+}
+
+internal inline void boids_pushNearest(boids_Nearest *near, u32 j, float d2)
+{
+    u32 at;
+    if(near->found < near->k) {
+        // sift the new boid up from the bottom
+        at = near->found++;
+        while(at && near->d2[(at - 1) / 2] < d2) {
+            near->d2[at] = near->d2[(at - 1) / 2];
+            near->boid[at] = near->boid[(at - 1) / 2];
+            at = (at - 1) / 2;
+        }
+    }
+    else if(d2 < near->d2[0]) {
+        // replace the farthest, and sift down from the top
+        at = 0;
+        for(;;) {
+            u32 child = 2 * at + 1;
+            if(child >= near->k) break;
+            if(child + 1 < near->k && near->d2[child + 1] > near->d2[child]) child++;
+            if(near->d2[child] <= d2) break;
+            near->d2[at] = near->d2[child];
+            near->boid[at] = near->boid[child];
+            at = child;
+        }
+    }
+    else return;
+    near->d2[at] = d2;
+    near->boid[at] = j;
+}
+
+internal inline float boids_spanGap(float at, float lo, float hi)
+{
+    return glm_max(glm_max(lo - at, at - hi), 0.0f);
+}
+
+internal void boids_splitChunks(void)
+{
+    boids_Flock *f = &the_boids;
+    boids_Grid *g = &the_grid;
+    boids_Chunk *chunks = wrm_Pool_dataAs(g->chunks, boids_Chunk);
+
+    // each halving of a sub-cell splits it about eight ways: stop once the boids per sub-cell are nearer the target
+    // than another halving would bring them, so a search looks at about the same number however crowded the chunk
+    u32 total = 0;
+    for(u32 c = 0; c < g->chunks.cap; c++) {
+        if(!g->chunks.is_used[c]) continue;
+        u32 split = 1;
+        while(split < BOIDS_KNN_MAX_SPLIT && chunks[c].count > BOIDS_KNN_CELL_BOIDS * split * split * split * 2.83f) split *= 2;
+        chunks[c].split = split;
+        chunks[c].sub = total;
+        if(split > 1) total += split * split * split + 1;
+    }
+
+    if(total > g->sub_cap) {
+        u32 *sub_start = realloc(g->sub_start, total * sizeof(u32));
+        if(!sub_start) {
+            fprintf(stderr, "ERROR: World: failed to allocate %u sub-cells\n", total);
+            for(u32 c = 0; c < g->chunks.cap; c++) if(g->chunks.is_used[c]) chunks[c].split = 1;
+            return;
+        }
+        g->sub_start = sub_start;
+        g->sub_cap = total;
+    }
+    u32 *scratch = realloc(g->scratch, f->cap * sizeof(u32));
+    if(!scratch) {
+        fprintf(stderr, "ERROR: World: failed to allocate sub-cell entries for %u boids\n", f->count);
+        for(u32 c = 0; c < g->chunks.cap; c++) if(g->chunks.is_used[c]) chunks[c].split = 1;
+        return;
+    }
+    g->scratch = scratch;
+
+    // a counting sort of each split chunk's part of cell_boids, by sub-cell
+    for(u32 c = 0; c < g->chunks.cap; c++) {
+        if(!g->chunks.is_used[c] || chunks[c].split == 1) continue;
+        boids_Chunk *chunk = chunks + c;
+        u32 subs = chunk->split * chunk->split * chunk->split;
+        u32 *start = g->sub_start + chunk->sub;
+        memset(start, 0, (subs + 1) * sizeof(u32));
+
+        for(u32 n = chunk->start; n < chunk->start + chunk->count; n++) {
+            start[boids_subCellOf(g->cell_boids[n], chunk, g->cell_size)]++;
+        }
+        // the running end of each sub-cell: filling below counts each back down to its start
+        u32 end = chunk->start;
+        for(u32 sub = 0; sub < subs; sub++) {
+            end += start[sub];
+            start[sub] = end;
+        }
+        start[subs] = end;
+        for(u32 n = chunk->start + chunk->count; n-- > chunk->start; ) {
+            u32 i = g->cell_boids[n];
+            g->scratch[--start[boids_subCellOf(i, chunk, g->cell_size)]] = i;
+        }
+        memcpy(g->cell_boids + chunk->start, g->scratch + chunk->start, chunk->count * sizeof(u32));
+    }
+}
+
+internal inline u32 boids_subCellOf(u32 i, const boids_Chunk *chunk, float cell_size)
+{
+    float width = cell_size / chunk->split;
+    u32 sub = 0;
+    for(i32 a = 2; a >= 0; a--) {
+        float at = the_boids.pos[i][a] - chunk->coord[a] * cell_size;
+        sub = sub * chunk->split + (u32)glm_clamp(floorf(at / width), 0.0f, (float)(chunk->split - 1));
+    }
+    return sub;
+}
+
+internal void boids_gatherSampled(u32 i, boids_Steer *s)
+{
+    boids_Grid *g = &the_grid;
+    float perception2 = BOIDS_PERCEPTION * BOIDS_PERCEPTION;
+    float separation2 = BOIDS_SEPARATION * BOIDS_SEPARATION;
+
+    boids_Chunk *chunks = wrm_Pool_dataAs(g->chunks, boids_Chunk);
+
+    // number the candidates in the 27 cells around the boid end to end, without looking at any of them
+    u32 cells = 0, total = 0;
+    u32 first[27], offset[27];
+    const u32 *around = chunks[g->boid_cell[i]].around;
+    for(u32 n = 0; n < 27; n++) {
+        if(around[n] == BOIDS_NONE) continue;
+        first[cells] = chunks[around[n]].start;
+        offset[cells] = total;
+        total += chunks[around[n]].count;
+        cells++;
+    }
+
+    u32 samples = glm_imin(BOIDS_SAMPLES, s->max_neighbors);
+    float stride = (float)total / (float)samples;
+    if(stride <= 1.0f) {
+        // few enough to look at every one
+        for(u32 n = 0; n < cells; n++) {
+            u32 end = n + 1 < cells ? offset[n + 1] : total;
+            for(u32 k = first[n]; k < first[n] + end - offset[n]; k++) {
+                if(g->cell_boids[k] != i) boids_see(s, i, g->cell_boids[k], perception2, separation2);
+            }
+        }
+        return;
+    }
+
+    // systematic sampling from a random start: every candidate is equally likely to be picked, and the start
+    // changes every tick so no boid is always left out
+    float start = (float)boids_hash(i, ticks_run) / 4294967296.0f;
+    u32 n = 0;
+    for(u32 sample = 0; sample < samples; sample++) {
+        u32 slot = glm_imin((u32)((sample + start) * stride), total - 1);
+        while(n + 1 < cells && slot >= offset[n + 1]) n++;
+        u32 j = g->cell_boids[first[n] + slot - offset[n]];
+        if(j != i) boids_see(s, i, j, perception2, separation2);
+    }
+
+    // alignment and cohesion are averages, which the sample estimates as it is; separation is a sum, so each
+    // sampled push stands in for all the candidates it was picked from
+    glm_vec3_scale(s->separation, stride, s->separation);
+}
+
+internal inline u32 boids_hash(u32 a, u32 b)
+{
+    u32 h = a * 0x9e3779b1u ^ (b + 0x7f4a7c15u);
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+internal void boids_gatherHalfShell(boids_Steer *steers)
+{
+    boids_Grid *g = &the_grid;
+    boids_Chunk *chunks = wrm_Pool_dataAs(g->chunks, boids_Chunk);
+    float perception2 = BOIDS_PERCEPTION * BOIDS_PERCEPTION;
+    float separation2 = BOIDS_SEPARATION * BOIDS_SEPARATION;
+
+    for(u32 c = 0; c < g->chunks.cap; c++) {
+        if(!g->chunks.is_used[c]) continue;
+        u32 begin = chunks[c].start;
+        u32 end = begin + chunks[c].count;
+
+        // each pair within the chunk once
+        for(u32 a = begin; a < end; a++) {
+            for(u32 b = a + 1; b < end; b++) {
+                boids_seeBoth(steers, g->cell_boids[a], g->cell_boids[b], perception2, separation2);
+            }
+        }
+
+        // and each pair with the 13 chunks after it in (z, y, x) order once: the other 13 see this one as theirs
+        for(u32 n = 14; n < 27; n++) {
+            u32 other = chunks[c].around[n];
+            if(other == BOIDS_NONE) continue;
+            for(u32 a = begin; a < end; a++) {
+                for(u32 b = chunks[other].start; b < chunks[other].start + chunks[other].count; b++) {
+                    boids_seeBoth(steers, g->cell_boids[a], g->cell_boids[b], perception2, separation2);
+                }
+            }
+        }
+    }
+}
+
+internal inline void boids_seeBoth(boids_Steer *steers, u32 i, u32 j, float perception2, float separation2)
+{
+    boids_Flock *f = &the_boids;
+    // both full, or sitting the tick out
+    if(steers[i].neighbors >= steers[i].max_neighbors && steers[j].neighbors >= steers[j].max_neighbors) return;
+
+    vec3 away;
+    glm_vec3_sub(f->pos[i], f->pos[j], away);
+    float d2 = glm_vec3_norm2(away);
+    if(d2 > perception2) return;
+
+    // one distance for both; each side still stops taking neighbors at the cap
+    float push = d2 < separation2 && d2 > 0.0f ? 1.0f / d2 : 0.0f;
+    boids_Steer *s = steers + i;
+    if(s->neighbors < s->max_neighbors) {
+        glm_vec3_muladds(away, push, s->separation);
+        glm_vec3_add(s->alignment, f->vel[j], s->alignment);
+        glm_vec3_add(s->cohesion, f->pos[j], s->cohesion);
+        s->neighbors++;
+    }
+    s = steers + j;
+    if(s->neighbors < s->max_neighbors) {
+        glm_vec3_muladds(away, -push, s->separation);
+        glm_vec3_add(s->alignment, f->vel[i], s->alignment);
+        glm_vec3_add(s->cohesion, f->pos[i], s->cohesion);
+        s->neighbors++;
+    }
+}
+
+internal bool boids_buildPyramid(void)
+{
+    boids_Flock *f = &the_boids;
+    boids_Grid *g = &the_grid;
+    boids_Pyramid *p = &pyramid;
+
+    // level 0 has the grid's cells; each level above doubles them, until they are as wide as the far field
+    p->levels = 1;
+    while(g->cell_size * (float)(1u << (p->levels - 1)) < BOIDS_FAR_PERCEPTION && p->levels < BOIDS_PYRAMID_MAX_LEVELS) {
+        p->levels++;
+    }
+
+    // binned from where the boids are now, which the grid's own bins may not be when neighbor lists skipped it
+    boids_Level *level = p->level;
+    boids_mapClear(&level->map);
+    level->cnt = 0;
+    for(u32 i = 0; i < f->count; i++) {
+        i32 coord[3];
+        boids_coordOf(f->pos[i], g->cell_size, coord);
+        boids_Aggregate *cell = boids_levelCell(level, coord);
+        if(!cell) {
+            p->levels = 0;
+            return false;
+        }
+        cell->count++;
+        glm_vec3_add(cell->pos_sum, f->pos[i], cell->pos_sum);
+        glm_vec3_add(cell->vel_sum, f->vel[i], cell->vel_sum);
+    }
+
+    if(level->cnt > p->far_cap) {
+        boids_Far *far = realloc(p->far, level->cnt * sizeof(boids_Far));
+        if(!far) {
+            fprintf(stderr, "ERROR: World: failed to allocate %u far-field cells\n", level->cnt);
+            p->levels = 0;
+            return false;
+        }
+        p->far = far;
+        p->far_cap = level->cnt;
+    }
+    for(u32 c = 0; c < level->cnt; c++) p->far[c].known = false;
+
+    // bottom-up: every cell adds itself into its parent
+    for(u32 l = 1; l < p->levels; l++) {
+        boids_Level *child = p->level + l - 1;
+        level = p->level + l;
+        boids_mapClear(&level->map);
+        level->cnt = 0;
+        for(u32 c = 0; c < child->cnt; c++) {
+            boids_Aggregate *from = child->cells + c;
+            i32 coord[3] = { boids_halve(from->coord[0]), boids_halve(from->coord[1]), boids_halve(from->coord[2]) };
+            boids_Aggregate *parent = boids_levelCell(level, coord);
+            if(!parent) {
+                p->levels = 0;
+                return false;
+            }
+            parent->count += from->count;
+            glm_vec3_add(parent->pos_sum, from->pos_sum, parent->pos_sum);
+            glm_vec3_add(parent->vel_sum, from->vel_sum, parent->vel_sum);
+        }
+    }
+    return true;
+}
+
+internal boids_Aggregate *boids_levelCell(boids_Level *level, const i32 coord[3])
+{
+    u32 c = boids_mapFind(&level->map, coord);
+    if(c != BOIDS_NONE) return level->cells + c;
+
+    if(level->cnt == level->cap) {
+        u32 cap = level->cap ? 2 * level->cap : BOIDS_CHUNK_POOL;
+        boids_Aggregate *cells = realloc(level->cells, cap * sizeof(boids_Aggregate));
+        if(!cells) {
+            fprintf(stderr, "ERROR: World: failed to allocate %u aggregate cells\n", cap);
+            return NULL;
+        }
+        level->cells = cells;
+        level->cap = cap;
+    }
+    if(!boids_mapInsert(&level->map, coord, level->cnt)) {
+        fprintf(stderr, "ERROR: World: failed to allocate an aggregate cell\n");
+        return NULL;
+    }
+
+    boids_Aggregate *cell = level->cells + level->cnt++;
+    *cell = (boids_Aggregate){ .coord = { coord[0], coord[1], coord[2] } };
+    return cell;
+}
+
+internal void boids_gatherFar(u32 i, boids_Steer *s)
+{
+    boids_Flock *f = &the_boids;
+    boids_Grid *g = &the_grid;
+    boids_Pyramid *p = &pyramid;
+    if(!p->levels) return;
+
+    // every boid in a cell sees much the same far field: work it out once per cell per tick, from the cell's
+    // center of mass, and share it
+    i32 coord[3];
+    boids_coordOf(f->pos[i], g->cell_size, coord);
+    u32 cell = boids_mapFind(&p->level[0].map, coord);
+    if(cell == BOIDS_NONE) return;
+    boids_Far *far = p->far + cell;
+    if(!far->known) {
+        boids_Aggregate *own = p->level[0].cells + cell;
+        vec3 center;
+        glm_vec3_scale(own->pos_sum, 1.0f / (float)own->count, center);
+        boids_queryFar(center, far);
+        far->known = true;
+    }
+
+    // less the boid itself, which is always in its own cell's field
+    s->far_count += far->count - 1.0f;
+    glm_vec3_add(s->far_pos, far->pos_sum, s->far_pos);
+    glm_vec3_sub(s->far_pos, f->pos[i], s->far_pos);
+    glm_vec3_add(s->far_vel, far->vel_sum, s->far_vel);
+    glm_vec3_sub(s->far_vel, f->vel[i], s->far_vel);
+}
+
+internal void boids_queryFar(const vec3 at, boids_Far *far)
+{
+    boids_Grid *g = &the_grid;
+    boids_Pyramid *p = &pyramid;
+    float radius2 = BOIDS_FAR_PERCEPTION * BOIDS_FAR_PERCEPTION;
+    far->count = 0.0f;
+    glm_vec3_zero(far->pos_sum);
+    glm_vec3_zero(far->vel_sum);
+
+    // start from the top level's cells the radius reaches into, and descend, taking whole cells wherever they
+    // answer for every boid in them; the top cells are as wide as the radius, so there are at most 27 of them
+    struct { u32 level; u32 cell; } stack[27 + 8 * BOIDS_PYRAMID_MAX_LEVELS];
+    u32 top = 0;
+    u32 l = p->levels - 1;
+    float top_size = g->cell_size * (float)(1u << l);
+    i32 lo[3], hi[3];
+    for(u32 a = 0; a < 3; a++) {
+        lo[a] = (i32)floorf((at[a] - BOIDS_FAR_PERCEPTION) / top_size);
+        hi[a] = (i32)floorf((at[a] + BOIDS_FAR_PERCEPTION) / top_size);
+    }
+    for(i32 z = lo[2]; z <= hi[2]; z++) {
+        for(i32 y = lo[1]; y <= hi[1]; y++) {
+            for(i32 x = lo[0]; x <= hi[0] && top < 27; x++) {
+                i32 coord[3] = { x, y, z };
+                u32 cell = boids_mapFind(&p->level[l].map, coord);
+                if(cell == BOIDS_NONE) continue;
+                stack[top].level = l;
+                stack[top].cell = cell;
+                top++;
+            }
+        }
+    }
+
+    while(top) {
+        top--;
+        u32 level = stack[top].level;
+        boids_Aggregate *cell = p->level[level].cells + stack[top].cell;
+
+        // the nearest and farthest the cell's box comes to the point
+        float size = g->cell_size * (float)(1u << level);
+        float near2 = 0.0f, far2 = 0.0f;
+        for(u32 a = 0; a < 3; a++) {
+            float lo = cell->coord[a] * size - at[a];
+            float hi = lo + size;
+            float nearest = glm_max(glm_max(lo, -hi), 0.0f);
+            float farthest = glm_max(-lo, hi);
+            near2 += nearest * nearest;
+            far2 += farthest * farthest;
+        }
+        if(near2 > radius2) continue;
+
+        // wholly inside, the sums are exact; straddling the edge, a cell small next to the radius is taken in part,
+        // by how far its center of mass is inside, as if its boids were spread evenly across it
+        float weight = 1.0f;
+        if(far2 > radius2) {
+            if(level && size >= BOIDS_FAR_OPENING * BOIDS_FAR_PERCEPTION) weight = -1.0f;
+            else {
+                vec3 center;
+                glm_vec3_scale(cell->pos_sum, 1.0f / (float)cell->count, center);
+                weight = glm_clamp((BOIDS_FAR_PERCEPTION - glm_vec3_distance(center, (float*)at)) / size + 0.5f, 0.0f, 1.0f);
+            }
+        }
+
+        if(weight >= 0.0f) {
+            far->count += weight * (float)cell->count;
+            glm_vec3_muladds(cell->pos_sum, weight, far->pos_sum);
+            glm_vec3_muladds(cell->vel_sum, weight, far->vel_sum);
+            continue;
+        }
+
+        // open the cell up into whichever of its 8 children have boids
+        boids_Level *below = p->level + level - 1;
+        for(i32 z = 0; z < 2; z++) {
+            for(i32 y = 0; y < 2; y++) {
+                for(i32 x = 0; x < 2; x++) {
+                    i32 coord[3] = { 2 * cell->coord[0] + x, 2 * cell->coord[1] + y, 2 * cell->coord[2] + z };
+                    u32 child = boids_mapFind(&below->map, coord);
+                    if(child == BOIDS_NONE) continue;
+                    stack[top].level = level - 1;
+                    stack[top].cell = child;
+                    top++;
+                }
+            }
+        }
+    }
+}
+
+internal void boids_setTiers(void)
+{
+    boids_Grid *g = &the_grid;
+    boids_Chunk *chunks = wrm_Pool_dataAs(g->chunks, boids_Chunk);
+
+    for(u32 c = 0; c < g->chunks.cap; c++) {
+        if(!g->chunks.is_used[c]) continue;
+        vec3 center;
+        for(u32 a = 0; a < 3; a++) center[a] = (chunks[c].coord[a] + 0.5f) * g->cell_size;
+        float dist = glm_vec3_distance(center, player_pos);
+
+        u32 tier = 0;
+        while(tier + 1 < BOIDS_LOD_TIERS && dist > BOIDS_LOD_DISTANCE[tier] * BOIDS_LOD_SCALE) tier++;
+        // coarser only once well past the line, so a chunk on it doesn't flicker between rates; finer right away
+        while(tier > chunks[c].tier && dist < BOIDS_LOD_DISTANCE[tier - 1] * BOIDS_LOD_SCALE + BOIDS_LOD_HYSTERESIS) tier--;
+        chunks[c].tier = tier;
+    }
+}
+
+internal void boids_settle(void)
+{
+    boids_Flock *f = &the_boids;
+    boids_Grid *g = &the_grid;
+    boids_Chunk *chunks = wrm_Pool_dataAs(g->chunks, boids_Chunk);
+    float bounds2 = BOIDS_BOUNDS_RADIUS * BOIDS_BOUNDS_RADIUS;
+
+    // quiet: its boids fly alike, few are coming in, and none are turning for home, which is steering of its own;
+    // one boid coming in never stirs a chunk on its own, however few it holds
+    for(u32 c = 0; c < g->chunks.cap; c++) {
+        if(!g->chunks.is_used[c]) continue;
+        boids_Chunk *chunk = chunks + c;
+        vec3 mean = {0};
+        float square = 0.0f;
+        bool inside = true;
+        for(u32 k = chunk->start; k < chunk->start + chunk->count; k++) {
+            u32 i = g->cell_boids[k];
+            glm_vec3_add(mean, f->vel[i], mean);
+            square += glm_vec3_norm2(f->vel[i]);
+            inside = inside && glm_vec3_distance2(f->pos[i], BOIDS_HOME) < bounds2;
+        }
+        glm_vec3_scale(mean, 1.0f / chunk->count, mean);
+        square /= chunk->count;
+        float variance = square > 0.0f ? 1.0f - glm_vec3_norm2(mean) / square : 0.0f;
+
+        float churn = chunk->entered / (BOIDS_SLEEP_CHURN * chunk->count + 1.0f);
+        // counted once: with Verlet lists ticks go by without a sort, and the same arrivals mustn't keep stirring it
+        chunk->entered = 0;
+        chunk->activity = inside ? glm_max(variance / BOIDS_SLEEP_VARIANCE, churn) : BOIDS_WAKE_ACTIVITY;
+        chunk->quiet_ticks = chunk->activity < 1.0f ? chunk->quiet_ticks + 1 : 0;
+    }
+
+    // a chunk sleeps once it has been quiet a while, and wakes as soon as it stirs or a neighbor is well stirred
+    for(u32 c = 0; c < g->chunks.cap; c++) {
+        if(!g->chunks.is_used[c]) continue;
+        boids_Chunk *chunk = chunks + c;
+        bool stirred = chunk->activity >= 1.0f;
+        for(u32 n = 0; n < 27 && !stirred; n++) {
+            stirred = chunk->around[n] != BOIDS_NONE && chunks[chunk->around[n]].activity >= BOIDS_WAKE_ACTIVITY;
+        }
+        if(stirred) chunk->asleep = false;
+        else if(chunk->quiet_ticks >= BOIDS_SLEEP_TICKS) chunk->asleep = true;
+    }
+}
+
+internal void boids_wake(const vec3 center, float radius)
+{
+    boids_Grid *g = &the_grid;
+    boids_Chunk *chunks = wrm_Pool_dataAs(g->chunks, boids_Chunk);
+    // out to the farthest corner of a chunk
+    float reach = radius + 0.87f * g->cell_size;
+
+    for(u32 c = 0; c < g->chunks.cap; c++) {
+        if(!g->chunks.is_used[c]) continue;
+        vec3 middle;
+        for(u32 a = 0; a < 3; a++) middle[a] = (chunks[c].coord[a] + 0.5f) * g->cell_size;
+        if(glm_vec3_distance2(middle, (float*)center) > reach * reach) continue;
+        chunks[c].asleep = false;
+        chunks[c].quiet_ticks = 0;
+    }
+}
+
+internal bool boids_schedule(u32 i, boids_Steer *s, float dt)
+{
+    boids_Flock *f = &the_boids;
+    const boids_Chunk *c = lod || sleeping ? wrm_Pool_dataAs(the_grid.chunks, boids_Chunk) + the_grid.boid_cell[i] : NULL;
+    u32 tier = lod ? c->tier : 0;
+    u32 period = 1u << tier;
+    u32 elapsed = ticks_run - f->steered[i];
+    if(elapsed < period || (sleeping && c->asleep)) {
+        s->max_neighbors = 0;
+        s->dt = 0.0f;
+        return false;
+    }
+
+    // one steer covers every tick since the last, up to the tier's period: a boid that just came in from a coarser
+    // tier doesn't make up for all the ticks it skipped
+    f->steered[i] = ticks_run;
+    s->dt = glm_imin(elapsed, period) * dt;
+    s->max_neighbors = glm_imax(BOIDS_MAX_NEIGHBORS >> tier, glm_imin(BOIDS_LOD_MIN_NEIGHBORS, BOIDS_MAX_NEIGHBORS));
+    return true;
+}
+
+internal void boids_steer(u32 i, boids_Steer *s, float dt)
+{
+    boids_Flock *f = &the_boids;
+
+    vec3 steer = {0};
+    if(s->neighbors) {
+        float inv = 1.0f / (float)s->neighbors;
+
+        // match the neighbors' average velocity, and head for their center
+        glm_vec3_scale(s->alignment, inv, s->alignment);
+        glm_vec3_sub(s->alignment, f->vel[i], s->alignment);
+        glm_vec3_scale(s->cohesion, inv, s->cohesion);
+        glm_vec3_sub(s->cohesion, f->pos[i], s->cohesion);
+
+        glm_vec3_muladds(s->separation, BOIDS_SEPARATION_WEIGHT, steer);
+        glm_vec3_muladds(s->alignment, BOIDS_ALIGNMENT_WEIGHT, steer);
+        glm_vec3_muladds(s->cohesion, BOIDS_COHESION_WEIGHT, steer);
+    }
+    if(s->far_count >= 1.0f) {
+        // the same pulls, gentler, toward the wider flock
+        float inv = 1.0f / s->far_count;
+        vec3 far_alignment, far_cohesion;
+        glm_vec3_scale(s->far_vel, inv, far_alignment);
+        glm_vec3_sub(far_alignment, f->vel[i], far_alignment);
+        glm_vec3_scale(s->far_pos, inv, far_cohesion);
+        glm_vec3_sub(far_cohesion, f->pos[i], far_cohesion);
+
+        glm_vec3_muladds(far_alignment, BOIDS_FAR_ALIGNMENT_WEIGHT, steer);
+        glm_vec3_muladds(far_cohesion, BOIDS_FAR_COHESION_WEIGHT, steer);
+    }
+
+    // turn back toward home once past the bounds, harder the further out
+    vec3 home;
+    glm_vec3_sub(BOIDS_HOME, f->pos[i], home);
+    float dist = glm_vec3_norm(home);
+    if(dist > BOIDS_BOUNDS_RADIUS) {
+        glm_vec3_muladds(home, BOIDS_BOUNDS_WEIGHT * (dist - BOIDS_BOUNDS_RADIUS) / dist, steer);
+    }
+
+    // written aside: the rest of the flock still steers from this tick's velocities
+    glm_vec3_copy(f->vel[i], f->next_vel[i]);
+    glm_vec3_muladds(steer, dt, f->next_vel[i]);
+}
+
+internal bool boids_verletValid(void)
+{
+    boids_Flock *f = &the_boids;
+    boids_Verlet *v = &verlet;
+    if(v->stale || v->boid_cnt != f->count) return false;
+
+    // distances between boids don't change when the whole flock moves together, so only movement relative to the
+    // flock's mean counts: a pair's distance can then have changed by at most twice the largest such movement
+    vec3 mean = {0};
+    for(u32 i = 0; i < f->count; i++) {
+        vec3 moved;
+        glm_vec3_sub(f->pos[i], v->ref_pos[i], moved);
+        glm_vec3_add(mean, moved, mean);
+    }
+    glm_vec3_scale(mean, 1.0f / (float)f->count, mean);
+
+    float limit2 = 0.25f * BOIDS_VERLET_SKIN * BOIDS_VERLET_SKIN;
+    for(u32 i = 0; i < f->count; i++) {
+        vec3 moved;
+        glm_vec3_sub(f->pos[i], v->ref_pos[i], moved);
+        glm_vec3_sub(moved, mean, moved);
+        if(glm_vec3_norm2(moved) > limit2) return false;
+    }
+    return true;
+}
+
+internal bool boids_buildVerlet(void)
+{
+    boids_Flock *f = &the_boids;
+    boids_Grid *g = &the_grid;
+    boids_Verlet *v = &verlet;
+    v->stale = true;
+
+    // cells as wide as the lists' radius, so every candidate is within the 27 surrounding cells
+    float radius = BOIDS_PERCEPTION + BOIDS_VERLET_SKIN;
+    boids_buildGrid(radius);
+    if(!g->cell_cnt) return false;
+
+    if(f->count + 1 > v->row_cap) {
+        u32 *start = realloc(v->start, (f->cap + 1) * sizeof(u32));
+        if(start) v->start = start;
+        vec3 *ref_pos = realloc(v->ref_pos, f->cap * sizeof(vec3));
+        if(ref_pos) v->ref_pos = ref_pos;
+        if(!start || !ref_pos) {
+            fprintf(stderr, "ERROR: World: failed to allocate neighbor lists for %u boids\n", f->count);
+            return false;
+        }
+        v->row_cap = f->cap + 1;
+    }
+
+    boids_Chunk *chunks = wrm_Pool_dataAs(g->chunks, boids_Chunk);
+    float radius2 = radius * radius;
+    u32 len = 0;
+    for(u32 i = 0; i < f->count; i++) {
+        v->start[i] = len;
+        glm_vec3_copy(f->pos[i], v->ref_pos[i]);
+
+        // room for a full row before scanning, so the scan itself never has to check
+        if(len + BOIDS_VERLET_CANDIDATES > v->cap) {
+            u32 cap = v->cap ? v->cap : BOIDS_VERLET_CANDIDATES * BOIDS_SPAWN_COUNT;
+            while(cap < len + BOIDS_VERLET_CANDIDATES) cap *= 2;
+            u32 *boids = realloc(v->boids, cap * sizeof(u32));
+            if(!boids) {
+                fprintf(stderr, "ERROR: World: failed to allocate %u neighbor list entries\n", cap);
+                return false;
+            }
+            v->boids = boids;
+            v->cap = cap;
+        }
+
+        u32 end = len + BOIDS_VERLET_CANDIDATES;
+        const u32 *around = chunks[g->boid_cell[i]].around;
+        for(u32 n = 0; n < 27 && len < end; n++) {
+            if(around[n] == BOIDS_NONE) continue;
+            boids_Chunk *c = chunks + around[n];
+            for(u32 k = c->start; k < c->start + c->count && len < end; k++) {
+                u32 j = g->cell_boids[k];
+                if(j != i && glm_vec3_distance2(f->pos[i], f->pos[j]) <= radius2) v->boids[len++] = j;
+            }
+        }
+    }
+    v->start[f->count] = len;
+
+    v->boid_cnt = f->count;
+    v->stale = false;
+    return true;
+}
+
+internal void boids_setQuality(u32 level)
+{
+    const boids_Quality *q = BOIDS_QUALITY + level;
+    governor.level = level;
+    governor.frames = 0;
+
+    BOIDS_TICK = q->tick;
+    BOIDS_MAX_NEIGHBORS = q->max_neighbors;
+    BOIDS_LOD_SCALE = q->lod_scale;
+
+    // trails keep their memory: shortening them only draws fewer samples, so it costs nothing to change back
+    if(trails.exists) wrm_render_setTrailsLength(trails.Handle_val, q->trail_length);
+}
+
+internal void boids_setTrails(bool visible)
+{
+    if(visible && !trails.exists) {
+        trails = wrm_render_createTrails(BOIDS_TRAIL_CAPACITY, BOIDS_TRAIL_LENGTH, BOIDS_TRAIL_COLOR);
+        if(!trails.exists) {
+            fprintf(stderr, "ERROR: World: failed to create boid trails\n");
+            return;
+        }
+        wrm_render_setTrailsLength(trails.Handle_val, BOIDS_QUALITY[governor.level].trail_length);
+    }
+    if(trails.exists) wrm_render_setTrailsVisible(trails.Handle_val, visible);
+    show_trails = visible;
+}
+
+internal void boids_page(void)
+{
+    boids_Pager *p = &pager;
+    boids_Flock *f = &the_boids;
+    if(!p->budget || ticks_run % BOIDS_PAGE_PERIOD) return;
+
+    // the tick's own sort will do, at whatever width it has: islands are coarse, and a sort at another width
+    // would throw away the Verlet lists' grid and every chunk's tier and sleep; only a flock changed since needs another
+    u32 islands = 0;
+    if(f->count) {
+        boids_Grid *g = &the_grid;
+        if(!g->cell_cnt || g->boid_cnt != f->count) boids_buildGrid(g->cell_size ? g->cell_size : BOIDS_PERCEPTION);
+        islands = boids_findIslands();
+    }
+
+    for(u32 k = 0; k < p->paged.len; ) {
+        boids_Paged *paged = p->paged.data + k;
+
+        // out of sight, a flock moves as one body, turning for home the way its boids would
+        float elapsed = (ticks_run - paged->tick) * BOIDS_TICK;
+        paged->tick = ticks_run;
+        vec3 home;
+        glm_vec3_sub(BOIDS_HOME, paged->center, home);
+        float dist = glm_vec3_norm(home);
+        if(dist > BOIDS_BOUNDS_RADIUS) {
+            glm_vec3_muladds(home, BOIDS_BOUNDS_WEIGHT * (dist - BOIDS_BOUNDS_RADIUS) / dist * elapsed, paged->vel);
+        }
+        float speed = glm_vec3_norm(paged->vel);
+        if(speed > BOIDS_MAX_SPEED) glm_vec3_scale(paged->vel, BOIDS_MAX_SPEED / speed, paged->vel);
+        glm_vec3_muladds(paged->vel, elapsed, paged->center);
+
+        // back in once the camera could see it, or a resident boid could
+        bool wanted = glm_vec3_distance(paged->center, player_pos) - paged->radius < BOIDS_PAGE_IN_DISTANCE;
+        for(u32 n = 0; n < islands && !wanted; n++) {
+            const boids_Island *island = p->islands + n;
+            wanted = glm_vec3_distance(paged->center, (float*)island->center) < paged->radius + island->radius + BOIDS_PERCEPTION;
+        }
+        // paging in moves the last flock into this slot
+        if(wanted && boids_pageIn(k)) continue;
+        k++;
+    }
+
+    if(islands && f->count > p->budget) boids_pageOut(islands);
+}
+
+internal u32 boids_findIslands(void)
+{
+    boids_Pager *p = &pager;
+    boids_Flock *f = &the_boids;
+    boids_Grid *g = &the_grid;
+    if(!g->cell_cnt) return 0;
+
+    if(g->chunks.cap > p->chunk_cap) {
+        u32 *chunk_island = realloc(p->chunk_island, g->chunks.cap * sizeof(u32));
+        if(chunk_island) p->chunk_island = chunk_island;
+        boids_Island *islands = realloc(p->islands, g->chunks.cap * sizeof(boids_Island));
+        if(islands) p->islands = islands;
+        u32 *order = realloc(p->order, g->chunks.cap * sizeof(u32));
+        if(order) p->order = order;
+        if(!chunk_island || !islands || !order) {
+            fprintf(stderr, "ERROR: World: failed to allocate islands for %u chunks\n", g->cell_cnt);
+            return 0;
+        }
+        p->chunk_cap = g->chunks.cap;
+    }
+
+    // join each chunk to the ones after it that touch it: the ones before join it from their side;
+    // the lowest chunk is always the root, so islands can be numbered in one pass below
+    boids_Chunk *chunks = wrm_Pool_dataAs(g->chunks, boids_Chunk);
+    u32 *parent = p->chunk_island;
+    for(u32 c = 0; c < g->chunks.cap; c++) parent[c] = c;
+    for(u32 c = 0; c < g->chunks.cap; c++) {
+        if(!g->chunks.is_used[c]) continue;
+        for(u32 n = 14; n < 27; n++) {
+            if(chunks[c].around[n] == BOIDS_NONE) continue;
+            u32 a = boids_islandRoot(parent, c);
+            u32 b = boids_islandRoot(parent, chunks[c].around[n]);
+            if(a < b) parent[b] = a;
+            else if(b < a) parent[a] = b;
+        }
+    }
+    for(u32 c = 0; c < g->chunks.cap; c++) {
+        if(g->chunks.is_used[c]) parent[c] = boids_islandRoot(parent, c);
+    }
+
+    // a root's entry becomes its island's number; the rest read it from their root, which comes before them
+    u32 islands = 0;
+    for(u32 c = 0; c < g->chunks.cap; c++) {
+        if(!g->chunks.is_used[c]) continue;
+        if(parent[c] == c) {
+            p->islands[islands] = (boids_Island){ .paged = BOIDS_NONE };
+            parent[c] = islands++;
+        }
+        else parent[c] = parent[parent[c]];
+
+        boids_Island *island = p->islands + parent[c];
+        for(u32 n = 0; n < chunks[c].count; n++) {
+            u32 i = g->cell_boids[chunks[c].start + n];
+            glm_vec3_add(island->center, f->pos[i], island->center);
+            glm_vec3_add(island->vel, f->vel[i], island->vel);
+        }
+        island->count += chunks[c].count;
+    }
+    for(u32 n = 0; n < islands; n++) {
+        glm_vec3_scale(p->islands[n].center, 1.0f / p->islands[n].count, p->islands[n].center);
+        glm_vec3_scale(p->islands[n].vel, 1.0f / p->islands[n].count, p->islands[n].vel);
+    }
+
+    // a sphere holding every chunk: the farthest chunk center, plus half a cell's diagonal
+    for(u32 c = 0; c < g->chunks.cap; c++) {
+        if(!g->chunks.is_used[c]) continue;
+        vec3 center;
+        for(u32 a = 0; a < 3; a++) center[a] = (chunks[c].coord[a] + 0.5f) * g->cell_size;
+        boids_Island *island = p->islands + p->chunk_island[c];
+        island->radius = glm_max(island->radius, glm_vec3_distance(center, island->center));
+    }
+    for(u32 n = 0; n < islands; n++) {
+        boids_Island *island = p->islands + n;
+        island->radius += 0.87f * g->cell_size;
+        island->distance = glm_max(glm_vec3_distance(island->center, player_pos) - island->radius, 0.0f);
+    }
+    return islands;
+}
+
+internal u32 boids_islandRoot(u32 *parent, u32 c)
+{
+    while(parent[c] != c) {
+        parent[c] = parent[parent[c]];
+        c = parent[c];
+    }
+    return c;
+}
+
+internal int boids_compareIslands(const void *a, const void *b)
+{
+    float da = pager.islands[*(const u32*)a].distance;
+    float db = pager.islands[*(const u32*)b].distance;
+    return (da < db) - (da > db);
+}
+
+internal void boids_pageOut(u32 islands)
+{
+    boids_Pager *p = &pager;
+    boids_Flock *f = &the_boids;
+    boids_Grid *g = &the_grid;
+
+    if(f->cap > p->evicted_cap) {
+        bool *evicted = realloc(p->evicted, f->cap * sizeof(bool));
+        if(!evicted) {
+            fprintf(stderr, "ERROR: World: failed to allocate paging flags for %u boids\n", f->count);
+            return;
+        }
+        p->evicted = evicted;
+        p->evicted_cap = f->cap;
+    }
+
+    // the farthest islands go first, but never ones near enough the camera to come straight back
+    for(u32 n = 0; n < islands; n++) p->order[n] = n;
+    qsort(p->order, islands, sizeof(u32), boids_compareIslands);
+    u32 resident = f->count;
+    for(u32 n = 0; n < islands && resident > p->budget; n++) {
+        boids_Island *island = p->islands + p->order[n];
+        if(island->distance < BOIDS_PAGE_OUT_DISTANCE) break;
+
+        if(p->paged.len == p->paged.cap) {
+            u32 cap = p->paged.cap ? 2 * p->paged.cap : 16;
+            boids_Paged *grown = realloc(p->paged.data, cap * sizeof(boids_Paged));
+            if(!grown) {
+                fprintf(stderr, "ERROR: World: failed to allocate room for %u paged flocks\n", cap);
+                break;
+            }
+            p->paged.data = grown;
+            p->paged.cap = cap;
+        }
+        boids_Extent records;
+        if(!boids_allocRecords(island->count, &records)) break;
+
+        boids_Paged *paged = p->paged.data + p->paged.len;
+        *paged = (boids_Paged){ .records = records, .radius = island->radius, .tick = ticks_run };
+        glm_vec3_copy(island->center, paged->center);
+        glm_vec3_copy(island->vel, paged->vel);
+        island->paged = p->paged.len++;
+        resident -= island->count;
+    }
+    if(resident == f->count) return;
+
+    // one pass over the chunks writes every island going out
+    memset(p->evicted, 0, f->count * sizeof(bool));
+    boids_Chunk *chunks = wrm_Pool_dataAs(g->chunks, boids_Chunk);
+    for(u32 c = 0; c < g->chunks.cap; c++) {
+        if(!g->chunks.is_used[c]) continue;
+        boids_Island *island = p->islands + p->chunk_island[c];
+        if(island->paged == BOIDS_NONE) continue;
+
+        const boids_Paged *paged = p->paged.data + island->paged;
+        boids_Record *records = p->records + paged->records.start + island->written;
+        for(u32 n = 0; n < chunks[c].count; n++) {
+            u32 i = g->cell_boids[chunks[c].start + n];
+            glm_vec3_sub(f->pos[i], (float*)paged->center, records[n].pos);
+            glm_vec3_sub(f->vel[i], (float*)paged->vel, records[n].vel);
+            p->evicted[i] = true;
+        }
+        island->written += chunks[c].count;
+    }
+    p->paged_boids += f->count - resident;
+
+    // close the gaps, keeping the rest in order
+    u32 kept = 0;
+    for(u32 i = 0; i < f->count; i++) {
+        if(p->evicted[i]) {
+            wrm_render_deleteModel(f->models[i]);
+            continue;
+        }
+        glm_vec3_copy(f->pos[i], f->pos[kept]);
+        glm_vec3_copy(f->vel[i], f->vel[kept]);
+        f->steered[kept] = f->steered[i];
+        f->models[kept] = f->models[i];
+        kept++;
+    }
+    f->count = kept;
+    verlet.stale = true;
+}
+
+internal bool boids_pageIn(u32 k)
+{
+    boids_Pager *p = &pager;
+    boids_Flock *f = &the_boids;
+    boids_Paged *paged = p->paged.data + k;
+    u32 count = paged->records.count;
+    if(!boids_reserve(count)) return false;
+
+    const boids_Record *records = p->records + paged->records.start;
+    for(u32 n = 0; n < count; n++) {
+        u32 i = f->count + n;
+        glm_vec3_add(paged->center, (float*)records[n].pos, f->pos[i]);
+        glm_vec3_add(paged->vel, (float*)records[n].vel, f->vel[i]);
+        f->steered[i] = ticks_run - 1 - i % (1u << (BOIDS_LOD_TIERS - 1));
+        if(!boids_createModel(i)) {
+            // all or nothing: half a flock back would leave the other half in the file twice over
+            while(n-- > 0) wrm_render_deleteModel(f->models[f->count + n]);
+            return false;
+        }
+    }
+    f->count += count;
+    p->paged_boids -= count;
+    verlet.stale = true;
+
+    boids_freeRecords(paged->records);
+    p->paged.data[k] = p->paged.data[--p->paged.len];
+    return true;
+}
+
+internal bool boids_allocRecords(u32 count, boids_Extent *extent)
+{
+    boids_Pager *p = &pager;
+    wrm_List_Extent *gaps = &p->gaps;
+
+    // the first gap it fits in, else the end of the file
+    for(u32 n = 0; n < gaps->len; n++) {
+        boids_Extent *gap = gaps->data + n;
+        if(gap->count < count) continue;
+        *extent = (boids_Extent){ gap->start, count };
+        gap->start += count;
+        gap->count -= count;
+        if(!gap->count) {
+            memmove(gap, gap + 1, (gaps->len - n - 1) * sizeof(boids_Extent));
+            gaps->len--;
+        }
+        return true;
+    }
+
+    if(p->end + count > p->cap) {
+        u32 cap = p->cap ? p->cap : BOIDS_PAGE_FILE_RECORDS;
+        while(cap < p->end + count) cap *= 2;
+        size_t bytes = (size_t)cap * sizeof(boids_Record);
+
+        if(ftruncate(p->fd, (off_t)bytes)) {
+            fprintf(stderr, "ERROR: World: failed to grow the page file to %zu bytes\n", bytes);
+            return false;
+        }
+        boids_Record *records = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, p->fd, 0);
+        if(records == MAP_FAILED) {
+            fprintf(stderr, "ERROR: World: failed to map %zu bytes of the page file\n", bytes);
+            return false;
+        }
+        if(p->records) munmap(p->records, (size_t)p->cap * sizeof(boids_Record));
+        p->records = records;
+        p->cap = cap;
+    }
+    *extent = (boids_Extent){ p->end, count };
+    p->end += count;
+    return true;
+}
+
+internal void boids_freeRecords(boids_Extent extent)
+{
+    boids_Pager *p = &pager;
+    wrm_List_Extent *gaps = &p->gaps;
+
+    u32 at = 0;
+    while(at < gaps->len && gaps->data[at].start < extent.start) at++;
+    bool joins_prev = at > 0 && gaps->data[at - 1].start + gaps->data[at - 1].count == extent.start;
+    bool joins_next = at < gaps->len && extent.start + extent.count == gaps->data[at].start;
+
+    if(joins_prev && joins_next) {
+        gaps->data[at - 1].count += extent.count + gaps->data[at].count;
+        memmove(gaps->data + at, gaps->data + at + 1, (gaps->len - at - 1) * sizeof(boids_Extent));
+        gaps->len--;
+    }
+    else if(joins_prev) gaps->data[at - 1].count += extent.count;
+    else if(joins_next) {
+        gaps->data[at].start = extent.start;
+        gaps->data[at].count += extent.count;
+    }
+    else {
+        if(gaps->len == gaps->cap) {
+            u32 cap = gaps->cap ? 2 * gaps->cap : 16;
+            boids_Extent *grown = realloc(gaps->data, cap * sizeof(boids_Extent));
+            // the run is only lost to reuse: the file grows a little sooner
+            if(!grown) return;
+            gaps->data = grown;
+            gaps->cap = cap;
+        }
+        memmove(gaps->data + at + 1, gaps->data + at, (gaps->len - at) * sizeof(boids_Extent));
+        gaps->data[at] = extent;
+        gaps->len++;
+    }
+
+    // a gap running up to the end just moves the end back
+    boids_Extent *last = gaps->data + gaps->len - 1;
+    if(last->start + last->count == p->end) {
+        p->end = last->start;
+        gaps->len--;
+    }
+}
@@ -3,6 +3,7 @@
 #include "wrm-render.h"
 #include "wrm-input.h"
 #include "boids-world.h"
+#include "boids-hud.h"
 
 
 static const char *BOIDS_APP_NAME = "cboids - boids in C!";
@@ -10,11 +11,38 @@ static const char *BOIDS_APP_NAME = "cboids - boids in C!";
 static const u8 REQUIRED_ARGS = 2;
 static const u8 ARG_STRLEN = 2;
 
+// number of frames drawn by a headless benchmark run
+static const u32 BOIDS_BENCH_FRAMES = 600;
+// where a benchmark run's per-frame timings are written
+static const char *BOIDS_STATS_PATH = "cboids-stats.csv";
+// where a recorded run is written, and the frame rate stamped on it
+static const char *BOIDS_CAPTURE_PATH = "cboids.y4m";
+static const u32 BOIDS_CAPTURE_FPS = 60;
+// where a paged run keeps the flocks it moves out of memory, and how much memory the rest may take: about 4096 boids
+static const char *BOIDS_PAGE_PATH = "cboids.page";
+static const size_t BOIDS_PAGE_BUDGET_BYTES = 1 << 20;
+// frame time interactive runs hold by lowering the resolution and simulation quality; benchmarks always run at full quality
+static const float BOIDS_FRAME_BUDGET_MS = 1000.0f / 60.0f;
+// the share of it the world's update gets, the rest being drawing: past it the governor lowers simulation quality,
+// or a budgeted run steers less of the flock
+static const float BOIDS_SIM_BUDGET_MS = 1000.0f / 60.0f / 2.0f;
+// shows and hides the performance overlay
+static const SDL_Scancode BOIDS_TOGGLE_HUD = SDL_SCANCODE_F3;
+
 u64 sdl_frequency;
 u64 sdl_counter;
 
-void boids_processFlags(int argc, char **argv, bool *verbose, bool *super_verbose);
-bool boids_init(bool verbose, bool super_verbose);
+bool headless;
+bool record;
+bool threaded;
+bool paged;
+bool budgeted;
+u32 frame_count;
+FILE *capture_file;
+FILE *stats_file;
+
+void boids_processFlags(int argc, char **argv, bool *verbose, bool *super_verbose, bool *headless, bool *record, bool *threaded, bool *paged, bool *budgeted);
+bool boids_init(bool verbose, bool super_verbose, bool headless, bool record, bool threaded, bool paged, bool budgeted);
 bool boids_update(void);
 void boids_quit(void);
 
@@ -24,16 +52,23 @@ Cboids - An interactive 3d flocking simulation made in C
 int main(int argc, char **argv)
 {
 	bool verbose, super_verbose;
-	boids_processFlags(argc, argv, &verbose, &super_verbose);
+	boids_processFlags(argc, argv, &verbose, &super_verbose, &headless, &record, &threaded, &paged, &budgeted);
 
-	if(!boids_init(verbose, super_verbose)) {
+	if(!boids_init(verbose, super_verbose, headless, record, threaded, paged, budgeted)) {
 		wrm_fail(1, "Failed to start cboids - see output for errors\n");
 	}
 
+	u64 start = SDL_GetPerformanceCounter();
 	while(boids_update()) {
 		// ... empty, we just want to call update() as long as we can
 	}
 
+	if(headless) {
+		double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+		printf("Benchmark: %u frames in %.3fs (%.3f ms/frame)\n", frame_count, seconds, 1000.0 * seconds / frame_count);
+		if(stats_file) printf("Benchmark: per-frame timings written to %s\n", BOIDS_STATS_PATH);
+	}
+
 	boids_quit();
 	return 0;
 }
@@ -42,14 +77,20 @@ int main(int argc, char **argv)
 // high-level helper implementations
 
 
-void boids_processFlags(int argc, char **argv, bool *verbose, bool *super_verbose)
+void boids_processFlags(int argc, char **argv, bool *verbose, bool *super_verbose, bool *headless, bool *record, bool *threaded, bool *paged, bool *budgeted)
 {
 	if(argc != REQUIRED_ARGS) wrm_fail(1, "Usage: cboids <arg>, use -h for further info\n");
 	
 	// try my match syntax
-	const char* options[] = {"-s", "-V", "-v", "-h"};
+	const char* options[] = {"-s", "-V", "-v", "-h", "-b", "-r", "-t", "-p", "-u"};
 	u8 n = sizeof(options) / sizeof(const char*);
 
+	*headless = false;
+	*record = false;
+	*threaded = false;
+	*paged = false;
+	*budgeted = false;
+
 	switch(wrm_cstrn_match(ARG_STRLEN, argv[1], options, n)) {
 		case 0:
 			wrm_fail(1, "Invalid argument\n");
@@ -67,18 +108,48 @@ void boids_processFlags(int argc, char **argv, bool *verbose, bool *super_verbos
 			break;
 		case 4:
 			printf(
-			"Command-line options:\n%s%s%s",
+			"Command-line options:\n%s%s%s%s%s%s%s%s",
 			" -v: verbose, print high-level application status during startup and exit\n",
 			" -V: super verbose, print high-level and submodule application status at startup and exit\n",
-			" -s: silent, do neither of the above\n"
+			" -s: silent, do neither of the above\n",
+			" -b: benchmark, draw a fixed number of frames headless (no window or input) and print timings\n",
+			" -r: record, write every frame to cboids.y4m while running verbose\n",
+			" -t: threaded, draw on a separate render thread while running verbose\n",
+			" -p: paged, move flocks far from the camera out of memory to a scratch file while running verbose\n",
+			" -u: budgeted, hold each world update to its time budget by steering only part of the flock, while running verbose\n"
 			);
 			// valid program end point
 			exit(EXIT_SUCCESS);
+		case 5:
+			*super_verbose = false;
+			*verbose = true;
+			*headless = true;
+			break;
+		case 6:
+			*super_verbose = false;
+			*verbose = true;
+			*record = true;
+			break;
+		case 7:
+			*super_verbose = false;
+			*verbose = true;
+			*threaded = true;
+			break;
+		case 8:
+			*super_verbose = false;
+			*verbose = true;
+			*paged = true;
+			break;
+		case 9:
+			*super_verbose = false;
+			*verbose = true;
+			*budgeted = true;
+			break;
 	}
 }
 
 
-bool boids_init(bool verbose, bool super_verbose)
+bool boids_init(bool verbose, bool super_verbose, bool headless, bool record, bool threaded, bool paged, bool budgeted)
 {
 	wrm_Window_Data args = {
 		.name = BOIDS_APP_NAME,
@@ -91,12 +162,36 @@ bool boids_init(bool verbose, bool super_verbose)
 	wrm_render_Settings r_settings = {
 		.verbose = super_verbose,
 		.errors = true,
-		.test = true
+		.test = true,
+		.headless = headless,
+		.threaded = threaded,
+		.frame_budget_ms = headless ? 0.0f : BOIDS_FRAME_BUDGET_MS
 	};
 
 	if(!wrm_render_init(&r_settings, &args)) return false;
 	if(verbose) printf("Renderer initialized!\n");
 
+	if(record) {
+		capture_file = fopen(BOIDS_CAPTURE_PATH, "wb");
+		if(!capture_file || !wrm_render_startCapture(capture_file, BOIDS_CAPTURE_FPS)) {
+			fprintf(stderr, "ERROR: failed to start recording to %s\n", BOIDS_CAPTURE_PATH);
+			if(capture_file) fclose(capture_file);
+			capture_file = NULL;
+		}
+		else if(verbose) printf("Recording to %s\n", BOIDS_CAPTURE_PATH);
+	}
+
+	if(headless) {
+		stats_file = fopen(BOIDS_STATS_PATH, "w");
+		if(stats_file) wrm_render_setStatsCSV(stats_file);
+		else fprintf(stderr, "ERROR: failed to open %s for benchmark timings\n", BOIDS_STATS_PATH);
+
+		// nothing to take input from: the world runs without player controls
+		boids_world_init(false, verbose);
+		sdl_counter = SDL_GetPerformanceCounter();
+		return true;
+	}
+
 	wrm_input_Settings i_settings = {
 		.errors = true
 	};
@@ -107,8 +202,22 @@ bool boids_init(bool verbose, bool super_verbose)
 	if(verbose) printf("Input initialized!\n");
 
 
-	if(!boids_world_init()) {
+	if(!boids_world_init(true, verbose)) {
+
+	}
+	// a budgeted world holds its own update time, so there is nothing left for the governor to trade
+	if(budgeted) boids_world_setTimeBudget(BOIDS_SIM_BUDGET_MS, verbose);
+	else boids_world_setGovernor(BOIDS_SIM_BUDGET_MS, verbose);
+
+	if(paged) {
+		if(!boids_world_setPaging(BOIDS_PAGE_PATH, BOIDS_PAGE_BUDGET_BYTES)) {
+			fprintf(stderr, "ERROR: failed to start paging to %s\n", BOIDS_PAGE_PATH);
+		}
+		else if(verbose) printf("Paging flocks past %zu KB to %s\n", BOIDS_PAGE_BUDGET_BYTES / 1024, BOIDS_PAGE_PATH);
+	}
 
+	if(!boids_hud_init()) {
+		fprintf(stderr, "ERROR: failed to create the performance HUD\n");
 	}
 
 	sdl_counter = SDL_GetPerformanceCounter();
@@ -127,25 +236,58 @@ bool boids_update(void)
 	sdl_counter = new_counter;
 
 	// first process events and input
-	wrm_input_update();
-	if(wrm_input_should_quit) {
-		return false;
+	if(headless) {
+		if(frame_count == BOIDS_BENCH_FRAMES) return false;
+	}
+	else {
+		wrm_input_update();
+		if(wrm_input_should_quit) {
+			return false;
+		}
+
+		wrm_Key hud = wrm_input_getKey(BOIDS_TOGGLE_HUD);
+		if(hud.down && !hud.counter) boids_hud_setVisible(!boids_hud_isVisible());
 	}
 
 	// then update the UI
 	// boids_ui_update(input);
 	
 	// then update the simulation world
+	u64 sim_start = SDL_GetPerformanceCounter();
 	boids_world_update(delta_time);
+	double sim_ms = (double)(SDL_GetPerformanceCounter() - sim_start) * 1000.0 / sdl_frequency;
+
+	// then trade quality for time if the world's updates are running long
+	boids_world_govern((float)sim_ms);
+
+	// then the overlay, which sees what the frame cost
+	if(!headless) boids_hud_update(delta_time, sim_ms, boids_world_getCount());
 
 	// then render the updates
 	wrm_render_draw(delta_time);
+	frame_count++;
 	return true;
 }
 
 void boids_quit(void)
 {
 	// destroy subsystems in REVERSE order of creation
-	wrm_input_quit();
+	if(capture_file) {
+		wrm_render_stopCapture();
+		fclose(capture_file);
+	}
+	if(stats_file) {
+		wrm_render_setStatsCSV(NULL);
+		fclose(stats_file);
+	}
+	if(!headless) boids_hud_quit();
+	if(budgeted) {
+		boids_Staleness stale;
+		boids_world_getStaleness(&stale);
+		printf("Budgeted: steered %u of %u partitions in the last update, %.1fms stale on average, %.1fms at worst\n",
+			stale.steered, stale.partitions, stale.mean_ms, stale.max_ms);
+	}
+	boids_world_quit();
+	if(!headless) wrm_input_quit();
 	wrm_render_quit();
 }
\ No newline at end of file
@@ -9,6 +9,7 @@ void wrm_Pool_init(wrm_Pool *p, size_t cap, size_t element_size)
     p->cap = cap;
     p->element_size = element_size;
     p->used = 0;
+    p->first_free = 0;
 
     p->data = calloc(cap, element_size);
     p->is_used = calloc(cap, sizeof(bool));
@@ -17,17 +18,28 @@ void wrm_Pool_init(wrm_Pool *p, size_t cap, size_t element_size)
 wrm_Option_Handle wrm_Pool_getSlot(wrm_Pool *p)
 {
     if(p->used == p->cap) {
-        if(!(realloc(p->data, p->cap * WRM_MEMORY_GROWTH_FACTOR * p->element_size ) && realloc(p->is_used, p->cap * WRM_MEMORY_GROWTH_FACTOR * p->element_size))) {
+        size_t new_cap = p->cap * WRM_MEMORY_GROWTH_FACTOR;
+        void *data = realloc(p->data, new_cap * p->element_size);
+        if(!data) {
             return (wrm_Option_Handle){.exists = false};
         }
-        p->cap *= WRM_MEMORY_GROWTH_FACTOR;
+        p->data = data;
+        bool *is_used = realloc(p->is_used, new_cap * sizeof(bool));
+        if(!is_used) {
+            return (wrm_Option_Handle){.exists = false};
+        }
+        p->is_used = is_used;
+        memset(p->is_used + p->cap, 0, (new_cap - p->cap) * sizeof(bool));
+        p->cap = new_cap;
         p->is_used[p->used] = true;
+        p->first_free = p->used + 1;
         return (wrm_Option_Handle){.exists = true, .Handle_val = p->used++};
     }
 
-    size_t i = 0;
+    size_t i = p->first_free;
     while(p->is_used[i]) { i++; }
     p->is_used[i] = true;
+    p->first_free = i + 1;
     p->used++;
     return (wrm_Option_Handle){.exists = true, .Handle_val = i};
 }
@@ -37,6 +49,7 @@ void wrm_Pool_freeSlot(wrm_Pool *p, wrm_Handle idx)
     if(idx >= p->cap) return;
     p->is_used[idx] = false;
     p->used--;
+    if(idx < p->first_free) p->first_free = idx;
 }
 
 void wrm_Pool_delete(wrm_Pool *p)
@@ -4,20 +4,35 @@
 #include "stb/stb_image.h"
 #include "glad/glad.h"
 
+#ifdef WRM_RENDER_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
 /*
 Internal type definitions
 */
 
+// threading constants
+
+// frames handed to the render thread and not yet drawn: the caller can run at most this far ahead
+#define WRM_RENDER_FRAMES_IN_FLIGHT 2
+
 // shader GL data, plus requirements of meshes rendered with it
 typedef struct wrm_Shader {
+    u32 refs;           // the creator's reference plus one per model using it
+    bool deleted;       // the creator's reference was released
     bool needs_col;
     bool needs_tex;
+    bool instanced;     // takes its model matrix per instance (i_model) rather than as a uniform
     GLuint vert;
     GLuint frag;
     GLuint program;
 } wrm_Shader;
 
 struct wrm_Texture {
+    u32 refs;           // the creator's reference plus one per model using it
+    bool deleted;       // the creator's reference was released
     GLuint gl_tex;
     // mipmap settings?
     // filter settings?
@@ -26,15 +41,62 @@ struct wrm_Texture {
 };
 
 struct wrm_Mesh {
+    u32 refs;           // the creator's reference plus one per model using it
+    bool deleted;       // the creator's reference was released
     GLuint vao;
     GLuint pos_vbo;
     GLuint uv_vbo;
     GLuint col_vbo;
     GLuint ebo;
+    size_t vtx_cnt;
     size_t tri_cnt;
+    float radius;       // of the bounding sphere around the mesh's origin
     bool cw;
+    bool dynamic;
+    // copies of the last uploaded data, only kept for dynamic meshes: updates diff against these
+    float *positions;
+    float *colors;
+    float *uvs;
+    u32 *indices;
 };
 
+// trail samples recorded since the last frame was built, handed from the building thread to the drawing thread
+typedef struct wrm_Trail_Stage {
+    float *rows;        // row_cnt rows of count xyz positions, oldest first
+    u32 row_cap;
+    u32 row_cnt;
+    u32 first;          // ring index the first row is written to
+    u32 head;           // ring index of the newest sample once the rows are written
+    u32 filled;         // valid samples in the ring once the rows are written
+    u32 count;          // points per row
+    u32 shown;          // newest samples drawn
+    bool visible;
+} wrm_Trail_Stage;
+
+// a ring of the last `length` positions of up to `capacity` points, stored sample-major:
+// each sample is one contiguous row, so recording a sample is a single upload at the ring head
+typedef struct wrm_Trails {
+    // GL side: only touched by the thread that owns the context
+    GLuint vao;
+    GLuint vbo;
+    GLuint ebo;         // static: the segment from each sample to the next, for every point
+    u32 capacity;
+    u32 length;
+    wrm_RGBAf color;
+    wrm_Trail_Stage stages[WRM_RENDER_FRAMES_IN_FLIGHT]; // one per frame in flight
+    bool deleted;       // no longer staged into new frames; destroyed once the frames holding it are drawn
+
+    // caller side: samples not yet handed to a frame
+    float *pending;
+    u32 pending_cap;
+    u32 pending_cnt;
+    u32 head;
+    u32 filled;
+    u32 count;
+    u32 shown;          // the length, unless shortened since: the ring keeps its size, only fewer samples are drawn
+    bool visible;
+} wrm_Trails;
+
 // camera data
 typedef struct wrm_Camera {
     float pitch;
@@ -44,9 +106,187 @@ typedef struct wrm_Camera {
     vec3 pos;
 } wrm_Camera;
 
-DEFINE_OPTION(GLuint, GLuint);
+// frame capture state: PBO readback on the GL side, a bounded queue of frames for the writer thread
+typedef struct wrm_Capture {
+    bool active;
+    FILE *out;
+    u32 w;
+    u32 h;
+    GLuint pbos[2];         // alternate each frame; a PBO is mapped one frame after its read was issued
+    u64 frames_read;        // number of glReadPixels issued into the PBOs
+    u64 frames_stalled;     // number of times the writer fell behind and the render had to wait for it
+
+    SDL_Thread *writer;
+    SDL_mutex *lock;
+    SDL_cond *cond;
+    u8 *slots[4];           // RGBA frames waiting to be written
+    u32 head;
+    u32 count;
+    bool stopping;
+} wrm_Capture;
+
+// dynamic resolution: the 3d pass is drawn into the corner of a window-sized target and scaled up to fill the window
+typedef struct wrm_Resolution {
+    float scale;            // fraction of the window's width and height the 3d pass is drawn at
+    double opaque_ms;       // GPU time of the 3d pass, summed over the frames timed since the scale was last adjusted
+    double fixed_ms;        // the rest of those frames' GPU time, which the scale doesn't change
+    u32 frames;
+    GLuint fbo;             // created the first time the scale drops below 1
+    GLuint color;
+    GLuint depth;
+} wrm_Resolution;
+
+// GPU timestamps taken during a frame, in submission order
+typedef enum wrm_render_Timestamp {
+    WRM_RENDER_TIMESTAMP_START,     // top of wrm_render_draw
+    WRM_RENDER_TIMESTAMP_UPLOAD,    // after per-frame buffer uploads
+    WRM_RENDER_TIMESTAMP_OPAQUE,    // after the 3d pass
+    WRM_RENDER_TIMESTAMP_UI,        // after the UI pass
+    WRM_RENDER_TIMESTAMP_COUNT
+} wrm_render_Timestamp;
+
+// one frame's worth of timer queries plus the CPU timings taken alongside them
+typedef struct wrm_Timer_Frame {
+    GLuint queries[WRM_RENDER_TIMESTAMP_COUNT];
+    bool pending;           // queries issued but not yet read back
+    wrm_render_Stats stats; // CPU side filled at submission, GPU side once the queries resolve
+} wrm_Timer_Frame;
 
-DEFINE_LIST(wrm_Model, Model);
+DEFINE_OPTION(GLuint, GLuint);
+DEFINE_LIST(GLuint, GLuint);
+DEFINE_LIST(wrm_Handle, Handle);
+
+// GL names of destroyed resources, deleted in batches at the start of a frame by the thread that owns the context
+typedef struct wrm_GL_Garbage {
+    wrm_List_GLuint buffers;
+    wrm_List_GLuint vaos;
+    wrm_List_GLuint textures;
+    wrm_List_GLuint programs;
+    wrm_List_GLuint shaders;
+} wrm_GL_Garbage;
+
+// texture units the state cache tracks bindings for
+#define WRM_RENDER_TEXTURE_UNITS 8
+
+// capabilities the state cache tracks, as indices into wrm_GL_State.enabled
+typedef enum wrm_GL_Cap {
+    WRM_GL_CAP_DEPTH_TEST,
+    WRM_GL_CAP_CULL_FACE,
+    WRM_GL_CAP_BLEND,
+    WRM_GL_CAP_COUNT
+} wrm_GL_Cap;
+
+// a shadow of the GL state the renderer changes most, so calls that would leave it unchanged are never made;
+// every change to this state must go through the wrm_render_gl* wrappers to keep the shadow true
+typedef struct wrm_GL_State {
+    GLuint program;
+    GLuint vao;
+    GLuint array_buffer;
+    GLenum active_unit;
+    GLuint textures[WRM_RENDER_TEXTURE_UNITS];
+    bool enabled[WRM_GL_CAP_COUNT];
+    bool depth_mask;
+    GLenum front_face;
+    GLenum blend_src;
+    GLenum blend_dst;
+    wrm_RGBAf clear_color;
+    u32 issued;         // calls made since the counters were last read
+    u32 skipped;        // calls dropped for not changing anything
+} wrm_GL_State;
+
+// per-model state bits, kept with the hot model data
+typedef enum wrm_Model_Flag {
+    WRM_MODEL_DIRTY = 1,    // the model's own transform changed since its world matrix was computed
+    WRM_MODEL_MOVED = 2,    // the world matrix was recomputed in the latest pass: children must follow
+    WRM_MODEL_VISIBLE = 4,  // in use and visible: the only models a frame looks at
+    WRM_MODEL_UI = 8,       // drawn in the UI pass, in window pixels, and never culled
+} wrm_Model_Flag;
+
+// the part of each model read every frame, split from the wrm_Model pool (the cold authoring data: local transform,
+// handles, hierarchy) and indexed by model handle, so preparing and culling a frame only walks these arrays
+typedef struct wrm_Model_Hot {
+    mat4 *worlds;       // cached world matrices
+    float *radii;       // world-space bounding sphere radius, around the world matrix's origin
+    u64 *keys;          // shader, texture and mesh packed so that one compare orders models by GL state
+    u8 *flags;          // wrm_Model_Flag bits
+    size_t cap;
+} wrm_Model_Hot;
+
+// one entry of the flattened hierarchy: the parent is kept here so the transform pass needn't touch the pool
+typedef struct wrm_Hierarchy_Node {
+    wrm_Handle model;
+    wrm_Handle parent;
+} wrm_Hierarchy_Node;
+
+DEFINE_LIST(wrm_Hierarchy_Node, Hierarchy_Node);
+
+// what the drawing side needs of a model: its final transform and the GL state it draws with
+typedef struct wrm_render_Draw {
+    mat4 world;
+    u64 key;
+} wrm_render_Draw;
+
+DEFINE_LIST(wrm_render_Draw, Draw);
+
+// adjacent draws sharing a shader, texture and mesh: drawn with one instanced call when the shader allows
+typedef struct wrm_render_Run {
+    u32 first;          // index of the run's first draw in the frame's draw list
+    u32 count;
+} wrm_render_Run;
+
+DEFINE_LIST(wrm_render_Run, Run);
+
+// one corner of a UI quad: window pixels, a spot in the atlas, and a color
+typedef struct wrm_UI_Vertex {
+    float pos[2];
+    float uv[2];
+    u8 col[4];
+} wrm_UI_Vertex;
+
+DEFINE_LIST(wrm_UI_Vertex, UI_Vertex);
+
+// a retained group of UI quads: its vertices are only generated when the widget is changed
+typedef struct wrm_Widget {
+    wrm_List_UI_Vertex vertices;
+    bool visible;
+} wrm_Widget;
+
+// the drawing thread's copy of every visible widget's vertices, re-sent only when a frame brings a newer version
+typedef struct wrm_UI_Batch {
+    GLuint vao;
+    GLuint vbo;
+    GLuint atlas;           // the font, plus one solid cell used by plain rectangles
+    u32 count;              // vertices in vbo
+    u32 version;
+} wrm_UI_Batch;
+
+// an immutable snapshot of everything needed to draw one frame, built by the caller of wrm_render_draw()
+typedef struct wrm_render_Frame {
+    float delta_time;
+    float frame_budget_ms;      // the dynamic resolution target when the frame was built
+    mat4 view;
+    mat4 persp;
+    mat4 ortho;
+    wrm_List_Draw models_tbd;   // models to be drawn, sorted by GL state changes
+    wrm_List_Draw ui_tbd;       // UI models (to be drawn with orthographic projection)
+    wrm_List_Run runs;          // models_tbd split into runs of identical GL state
+    wrm_List_Handle trails;     // trails staged for this frame: the pool may change while the frame is drawn
+    wrm_List_UI_Vertex ui_vertices; // every visible widget, in handle order, as of ui_version
+    u32 ui_version;
+    double cpu_build_ms;
+    double cpu_sort_ms;
+    u32 models_culled;
+} wrm_render_Frame;
+
+// a GL call forwarded to the render thread: fn unpacks args, makes the call, and stores its result
+typedef struct wrm_GL_Call {
+    void (*fn)(struct wrm_GL_Call *call);
+    const void *ptrs[2];
+    u32 vals[2];
+    wrm_Option_Handle handle;
+    bool success;
+    bool done;
+} wrm_GL_Call;
 
 /*
 Constants
@@ -62,9 +302,20 @@ typedef enum wrm_render_Resource_Type {
     WRM_RENDER_RESOURCE_MODEL, 
     WRM_RENDER_RESOURCE_MESH, 
     WRM_RENDER_RESOURCE_SHADER, 
-    WRM_RENDER_RESOURCE_TEXTURE
+    WRM_RENDER_RESOURCE_TEXTURE,
+    WRM_RENDER_RESOURCE_TRAILS,
+    WRM_RENDER_RESOURCE_WIDGET
 } wrm_render_Resource_Type;
 
+// a resource no longer referenced, waiting for the frames that may still draw it
+typedef struct wrm_Release {
+    wrm_render_Resource_Type type;
+    wrm_Handle handle;
+    u32 fence;          // frames built when it was released: destroyed once this many have been drawn
+} wrm_Release;
+
+DEFINE_LIST(wrm_Release, Release);
+
 // general rendering constants
 internal const float WRM_NEAR_CLIP_DISTANCE = 0.001f;
 internal const float WRM_FAR_CLIP_DISTANCE = 1000.0f;
@@ -76,18 +327,19 @@ internal const u32 WRM_SHADER_ATTRIB_POS_LOC = 0;
 internal const u32 WRM_SHADER_ATTRIB_COL_LOC = 1;
 internal const u32 WRM_SHADER_ATTRIB_UV_LOC = 2;
 // internal const u32 WRM_SHADER_ATTRIB_NORM_LOC = 3; // unused (yet)
+internal const u32 WRM_SHADER_ATTRIB_INSTANCE_LOC = 4; // a mat4: takes locations 4 to 7
 
 internal const char *WRM_SHADER_DEFAULT_COL_V_TEXT = {
 "#version 330 core\n"
 "layout (location = 0) in vec3 v_pos;\n" // positions are location 0
 "layout (location = 1) in vec4 v_col;\n" // colors are location 1
-"uniform mat4 model;\n"
+"layout (location = 4) in mat4 i_model;\n" // per-instance model matrix takes locations 4-7
 "uniform mat4 persp;\n"
 "uniform mat4 view;\n"
 "out vec4 col;\n" // specify a color output to the fragment shader
 "void main()\n"
 "{\n"
-"    gl_Position = persp * view * model * vec4(v_pos, 1.0);\n"
+"    gl_Position = persp * view * i_model * vec4(v_pos, 1.0);\n"
 "    col = v_col;\n"
 "}\n"
 };
@@ -107,13 +359,13 @@ internal const char *WRM_SHADER_DEFAULT_TEX_V_TEXT = {
 "#version 330 core\n"
 "layout (location = 0) in vec3 v_pos;\n" // positions are location 0
 "layout (location = 2) in vec2 v_uv;\n"  // uvs are location 2
-"uniform mat4 model;\n"
+"layout (location = 4) in mat4 i_model;\n"
 "uniform mat4 persp;\n"
 "uniform mat4 view;\n"
 "out vec2 uv;\n" // specify a uv for the fragment shader
 "void main()\n"
 "{\n"
-"    gl_Position = persp * view * model * vec4(v_pos, 1.0);\n" 
+"    gl_Position = persp * view * i_model * vec4(v_pos, 1.0);\n" 
 "    uv = v_uv;\n"
 "}\n"
 };
@@ -134,14 +386,14 @@ internal const char *WRM_SHADER_DEFAULT_BOTH_V_TEXT = {
 "layout (location = 0) in vec3 v_pos;\n" // positions are location 0
 "layout (location = 1) in vec4 v_col;\n"
 "layout (location = 2) in vec2 v_uv;\n"  // uvs are location 2
-"uniform mat4 model;\n"
+"layout (location = 4) in mat4 i_model;\n"
 "uniform mat4 persp;\n"
 "uniform mat4 view;\n"
 "out vec4 col;\n" // specify a color for the fragment shader
 "out vec2 uv;\n" // specify a uv for the fragment shader\n"
 "void main()\n"
 "{\n"
-"    gl_Position = persp * view * model * vec4(v_pos, 1.0);\n"
+"    gl_Position = persp * view * i_model * vec4(v_pos, 1.0);\n"
 "    col = v_col;\n" 
 "    uv = v_uv;\n"
 "}\n"
@@ -158,6 +410,162 @@ internal const char *WRM_SHADER_DEFAULT_BOTH_F_TEXT = {
 "}\n"
 };
 
+// trails: the vertex id of an indexed draw is the index itself, which gives the sample's ring slot and so its age
+internal const char *WRM_SHADER_TRAIL_V_TEXT = {
+"#version 330 core\n"
+"layout (location = 0) in vec3 v_pos;\n"
+"uniform mat4 persp;\n"
+"uniform mat4 view;\n"
+"uniform int head;\n"
+"uniform int len;\n"
+"uniform int capacity;\n"
+"uniform int shown;\n"
+"uniform vec4 color;\n"
+"out vec4 col;\n"
+"void main()\n"
+"{\n"
+"    int age = (head - gl_VertexID / capacity + len) % len;\n"
+"    gl_Position = persp * view * vec4(v_pos, 1.0);\n"
+"    col = vec4(color.rgb, color.a * (1.0 - float(age) / float(shown)));\n"
+"}\n"
+};
+internal const char *WRM_SHADER_TRAIL_F_TEXT = {
+"#version 330 core\n"
+"in vec4 col;\n"
+"out vec4 FragColor;\n"
+"void main()\n"
+"{\n"
+"    FragColor = col;\n"
+"}\n"
+};
+
+// UI: the atlas is a single coverage channel, so glyphs and rectangles share one texture and one draw
+internal const char *WRM_SHADER_UI_V_TEXT = {
+"#version 330 core\n"
+"layout (location = 0) in vec2 v_pos;\n"
+"layout (location = 1) in vec4 v_col;\n"
+"layout (location = 2) in vec2 v_uv;\n"
+"uniform mat4 ortho;\n"
+"out vec4 col;\n"
+"out vec2 uv;\n"
+"void main()\n"
+"{\n"
+"    gl_Position = ortho * vec4(v_pos, 0.0, 1.0);\n"
+"    col = v_col;\n"
+"    uv = v_uv;\n"
+"}\n"
+};
+internal const char *WRM_SHADER_UI_F_TEXT = {
+"#version 330 core\n"
+"in vec4 col;\n"
+"in vec2 uv;\n"
+"uniform sampler2D atlas;\n"
+"out vec4 FragColor;\n"
+"void main()\n"
+"{\n"
+"    FragColor = vec4(col.rgb, col.a * texture(atlas, uv).r);\n"
+"}\n"
+};
+
+// UI font: 8x8 glyphs for printable ASCII (32 to 126), one byte per row from the top, lowest bit leftmost
+internal const u8 WRM_UI_FONT[95][8] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, //  
+    { 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 }, // !
+    { 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // "
+    { 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 }, // #
+    { 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 }, // $
+    { 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 }, // %
+    { 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 }, // &
+    { 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '
+    { 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 }, // (
+    { 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 }, // )
+    { 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 }, // *
+    { 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 }, // +
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ,
+    { 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 }, // -
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // .
+    { 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 }, // /
+    { 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 }, // 0
+    { 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 }, // 1
+    { 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 }, // 2
+    { 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 }, // 3
+    { 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 }, // 4
+    { 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 }, // 5
+    { 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 }, // 6
+    { 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 }, // 7
+    { 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 }, // 8
+    { 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 }, // 9
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // :
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ;
+    { 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 }, // <
+    { 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 }, // =
+    { 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 }, // >
+    { 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 }, // ?
+    { 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 }, // @
+    { 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 }, // A
+    { 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 }, // B
+    { 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 }, // C
+    { 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 }, // D
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 }, // E
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 }, // F
+    { 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 }, // G
+    { 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 }, // H
+    { 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // I
+    { 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 }, // J
+    { 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 }, // K
+    { 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 }, // L
+    { 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 }, // M
+    { 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 }, // N
+    { 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 }, // O
+    { 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 }, // P
+    { 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 }, // Q
+    { 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 }, // R
+    { 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 }, // S
+    { 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // T
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 }, // U
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // V
+    { 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 }, // W
+    { 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 }, // X
+    { 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 }, // Y
+    { 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 }, // Z
+    { 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 }, // [
+    { 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 }, // backslash
+    { 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 }, // ]
+    { 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 }, // ^
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF }, // _
+    { 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 }, // `
+    { 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 }, // a
+    { 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 }, // b
+    { 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 }, // c
+    { 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 }, // d
+    { 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 }, // e
+    { 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 }, // f
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // g
+    { 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 }, // h
+    { 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // i
+    { 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E }, // j
+    { 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 }, // k
+    { 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // l
+    { 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 }, // m
+    { 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 }, // n
+    { 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 }, // o
+    { 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F }, // p
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 }, // q
+    { 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 }, // r
+    { 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 }, // s
+    { 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 }, // t
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 }, // u
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // v
+    { 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 }, // w
+    { 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 }, // x
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // y
+    { 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 }, // z
+    { 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 }, // {
+    { 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 }, // |
+    { 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 }, // }
+    { 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ~
+};
+
 // default meshes
 wrm_Mesh_Data default_color_mesh_data = {
     .positions = (float[]) {
@@ -278,6 +686,30 @@ wrm_Mesh_Data default_texture_mesh_data = {
     .vtx_cnt = 24,
 };
 
+// timing constants
+
+// frames of timer queries kept in flight: results are read this many frames late so reading never blocks
+#define WRM_RENDER_TIMER_LATENCY 4
+
+// capture constants
+
+#define WRM_CAPTURE_QUEUE_LEN (sizeof(((wrm_Capture*)0)->slots) / sizeof(u8*))
+
+// dynamic resolution constants
+
+internal const u32 WRM_RESOLUTION_PERIOD = 8;           // timed frames averaged between adjustments
+internal const float WRM_RESOLUTION_HEADROOM = 0.8f;    // the scale only grows while the GPU takes under this share of the budget
+internal const float WRM_RESOLUTION_MAX_DROP = 0.75f;   // per adjustment: drops quickly, recovers slowly
+internal const float WRM_RESOLUTION_MAX_RISE = 0.05f;
+internal const float WRM_RESOLUTION_DEFAULT_MIN = 0.5f;
+internal const float WRM_RESOLUTION_SNAP = 0.97f;       // close enough to full size to skip the blit
+
+// UI constants: the atlas is a grid of 8x8 cells, one per ASCII code; cell 0 is solid, for rectangles
+
+#define WRM_UI_CELL 8
+#define WRM_UI_ATLAS_COLS 16
+#define WRM_UI_ATLAS_ROWS 8
+
 // pool constants
 
 internal const u32 WRM_RENDER_POOL_INITIAL_CAPACITY = 20;
@@ -287,6 +719,10 @@ internal const u32 WRM_RENDER_POOL_INITIAL_CAPACITY = 20;
 internal const u32 WRM_RENDER_LIST_INITIAL_CAPACITY = 10;
 internal const u32 WRM_RENDER_LIST_SCALE_FACTOR = 2;
 
+// bits per handle in a model's sort key: shader, then texture, then mesh
+#define WRM_RENDER_KEY_BITS 21
+#define WRM_RENDER_KEY_MASK ((1ull << WRM_RENDER_KEY_BITS) - 1)
+
 
 /*
 Internal helper declarations
@@ -296,22 +732,139 @@ Internal helper declarations
 internal void wrm_render_initLists(void);
 // compiles an individual shader program of the given GL type (GL_VERTEX_SHADER, GL_FRAGMENT_SHADER)
 internal wrm_Option_GLuint wrm_render_compileShader(const char *shader_text, GLenum type);
-// comparison function for sorting models: 
-internal int wrm_render_compareModels(const void *model1, const void *model2);
+// comparison function for sorting draws by the GL state they need: shader, then texture, then mesh
+internal int wrm_render_compareDraws(const void *draw1, const void *draw2);
 // creates a default shader for meshes with per-vertex colors, per-vertex uv's, and both
 internal void wrm_render_createDefaultShaders(void);
 // creates a default pink-and-black error texture
 internal void wrm_render_createErrorTexture(void);
 // creates a default test triangle
 internal void wrm_render_createTestModel(void);
-// creates a list from the pool of models, sorted by GL state changes
-internal inline void wrm_render_prepareModels(void);
+// creates an EGL context with no window (surfaceless if possible) and loads GL functions
+internal bool wrm_render_initHeadless(void);
+// creates the framebuffer that headless frames are drawn into
+internal bool wrm_render_createOffscreenTarget(void);
+// creates a window-sized framebuffer with color and depth-stencil renderbuffers
+internal bool wrm_render_createTarget(GLuint *fbo, GLuint *color, GLuint *depth);
+// steers the 3d pass' resolution scale toward the frame's budget from the GPU times of frames already drawn
+internal void wrm_render_adjustResolution(const wrm_render_Frame *f);
+// presents the finished frame: a buffer swap when windowed, a flush when headless
+internal inline void wrm_render_present(void);
+// issues an async readback of the finished frame and hands the previous one to the capture writer
+internal void wrm_render_captureFrame(void);
+// copies a mapped RGBA frame into the capture queue, waiting if the writer is behind
+internal void wrm_render_captureEnqueue(const u8 *rgba);
+// capture writer thread: converts queued frames to YUV 4:2:0 and writes them as Y4M
+internal int wrm_render_captureWriter(void *arg);
+// takes or releases the GL context on the calling thread
+internal bool wrm_render_makeCurrent(bool current);
+// whether the calling thread owns the GL context; when it doesn't, GL work must go through callOnRenderThread()
+internal inline bool wrm_render_ownsContext(void);
+// runs a GL call on the render thread and waits for it to finish
+internal void wrm_render_callOnRenderThread(wrm_GL_Call *call);
+// render thread: runs forwarded GL calls and draws frames as they are handed off
+internal int wrm_render_threadMain(void *arg);
+// wrm_GL_Call entry points for the public functions that touch GL
+internal void wrm_render_readPixelsCall(wrm_GL_Call *call);
+internal void wrm_render_startCaptureCall(wrm_GL_Call *call);
+internal void wrm_render_stopCaptureCall(wrm_GL_Call *call);
+internal void wrm_render_createShaderCall(wrm_GL_Call *call);
+internal void wrm_render_createTextureCall(wrm_GL_Call *call);
+internal void wrm_render_createMeshCall(wrm_GL_Call *call);
+internal void wrm_render_cloneMeshCall(wrm_GL_Call *call);
+internal void wrm_render_updateMeshCall(wrm_GL_Call *call);
+internal void wrm_render_createTrailsCall(wrm_GL_Call *call);
+// takes a reference to a mesh, texture or shader for a model; one already deleted may be queued for release, so it takes none
+internal void wrm_render_addRef(wrm_render_Resource_Type type, wrm_Handle h);
+// drops a reference to a mesh, texture or shader; the last one queues it for destruction
+internal void wrm_render_releaseRef(wrm_render_Resource_Type type, wrm_Handle h);
+// queues a resource for destruction once the frames that may draw it are done
+internal void wrm_render_queueRelease(wrm_render_Resource_Type type, wrm_Handle h);
+// destroys released resources no frame in flight can still draw, handing their GL names to the next frame
+internal void wrm_render_collectReleases(bool all);
+// frees a released resource's pool slot and client memory, and queues its GL names for deletion
+internal void wrm_render_destroy(wrm_render_Resource_Type type, wrm_Handle h);
+// deletes every queued GL name in one batch per kind; runs on the thread that owns the context
+internal void wrm_render_deleteGarbage(void);
+// appends a GL name to a garbage list; 0 (never created) is skipped
+internal void wrm_render_pushGarbage(wrm_List_GLuint *list, GLuint name);
+// sets the state cache to a fresh context's defaults
+internal void wrm_render_resetGLCache(void);
+// state cache wrappers: each makes its GL call only when it would change something
+internal inline void wrm_render_glUseProgram(GLuint program);
+internal inline void wrm_render_glBindVertexArray(GLuint vao);
+internal inline void wrm_render_glBindArrayBuffer(GLuint buffer);
+internal inline void wrm_render_glBindTexture(u32 unit, GLuint texture);
+internal inline void wrm_render_glSetCap(wrm_GL_Cap cap, bool enabled);
+internal inline void wrm_render_glDepthMask(bool mask);
+internal inline void wrm_render_glFrontFace(GLenum mode);
+internal inline void wrm_render_glBlendFunc(GLenum src, GLenum dst);
+internal inline void wrm_render_glClearColor(wrm_RGBAf color);
+// clears cached names that were just deleted: GL falls back to 0 for them, and a recycled name must not look bound
+internal void wrm_render_glForgetBuffer(GLuint buffer);
+internal void wrm_render_glForgetVertexArray(GLuint vao);
+internal void wrm_render_glForgetProgram(GLuint program);
+internal void wrm_render_glForgetTexture(GLuint texture);
+// points a mesh's VAO at its buffers; the VAO and its element buffer must already be bound
+internal void wrm_render_setupMeshVAO(const wrm_Mesh *m);
+// points the bound VAO's per-instance model matrix at the given draw in the instance buffer
+internal void wrm_render_setInstanceOffset(u32 first);
+// uploads a frame's draw list to the instance buffer
+internal void wrm_render_uploadInstances(const wrm_render_Frame *f);
+// splits a sorted draw list into runs of identical GL state; only instanced shaders get runs longer than one
+internal void wrm_render_findRuns(wrm_render_Frame *f);
+// mallocs a copy of size bytes of src; returns NULL for NULL src
+internal void *wrm_render_copyBuffer(const void *src, size_t size);
+// creates a new buffer holding a GPU-side copy of src; returns 0 for a 0 src
+internal GLuint wrm_render_cloneBuffer(GLuint src, size_t size, GLenum usage);
+// uploads new contents to a buffer of elem_size elements: only the changed range when a copy of the old contents is kept
+internal size_t wrm_render_updateBuffer(GLuint buffer, void **shadow, const void *src, size_t old_cnt, size_t new_cnt, size_t elem_size, GLenum usage);
+// moves each set of trails' pending samples into the given frame, and lists them in it
+internal void wrm_render_stageTrails(wrm_render_Frame *f);
+// uploads the samples staged for a frame into each ring
+internal void wrm_render_uploadTrails(wrm_render_Frame *f);
+// draws a frame's visible trails as line segments, skipping the ring's wrap-around
+internal void wrm_render_drawTrails(wrm_render_Frame *f);
+// builds the font atlas and the buffers every widget is drawn from
+internal void wrm_render_createUIBatch(void);
+// copies every visible widget's vertices into a frame, unless the frame already holds the current version
+internal void wrm_render_stageUI(wrm_render_Frame *f);
+// re-sends a frame's widget vertices to the GPU when they are newer than the last ones sent
+internal void wrm_render_uploadUI(const wrm_render_Frame *f);
+// draws a frame's UI models, then every widget in one call
+internal void wrm_render_drawUI(wrm_render_Frame *f);
+// appends a quad showing one atlas cell (0 for solid) to a widget's vertices
+internal bool wrm_render_pushQuad(wrm_Widget *w, float x, float y, float width, float height, u32 cell, wrm_RGBAf color);
+// fills a frame snapshot from the current camera and model pool
+internal void wrm_render_buildFrame(wrm_render_Frame *f, float delta_time);
+// draws a frame snapshot and presents it; runs on whichever thread owns the GL context
+internal void wrm_render_drawFrame(wrm_render_Frame *f);
+// creates the timer query pool
+internal void wrm_render_initTimers(void);
+// reads back every frame of timer queries that has finished on the GPU, without waiting on any
+internal void wrm_render_resolveTimers(void);
+// milliseconds elapsed since a performance counter value
+internal inline double wrm_render_msSince(u64 start);
+// grows the hot model arrays to match the capacity of the model pool
+internal bool wrm_render_growModelArrays(void);
+// packs a model's shader, texture and mesh into its sort key
+internal inline u64 wrm_render_modelKey(const wrm_Model *m);
+// radius of the bounding sphere around a mesh's origin
+internal float wrm_render_meshRadius(const float *positions, size_t vtx_cnt);
+// removes a model from its parent's list of children
+internal void wrm_render_detachModel(wrm_Handle model);
+// lists every model parent-before-child, breadth first from the roots
+internal void wrm_render_rebuildHierarchy(void);
+// recomputes world matrices in one pass over the hierarchy, only for models that moved or whose parent did
+internal void wrm_render_updateWorlds(void);
+// creates a list of the visible models inside the view frustum, sorted by GL state changes
+internal inline void wrm_render_prepareModels(wrm_render_Frame *f);
 // checks whether certain resources are in use
 internal inline bool wrm_render_isInUse(wrm_Handle h, wrm_render_Resource_Type t, const char *caller);
 // gets the view matrix from the current camera orientation
 internal inline void wrm_render_getViewMatrix(mat4 view);
-// sets the GL state before a draw call
-internal inline void wrm_render_setGLState(wrm_Model *curr, wrm_Model *prev, mat4 model, mat4 view, mat4 persp, u32 *elements);
+// sets the GL state before a draw call, except the model matrix; returns the shader now in use
+internal inline wrm_Shader *wrm_render_setGLState(wrm_render_Draw *curr, wrm_render_Draw *prev, mat4 view, mat4 persp, u32 *elements);
 
 
 /*
@@ -328,6 +881,16 @@ internal wrm_render_Settings wrm_render_settings;
 internal SDL_Window *wrm_window = NULL; // SDL window 
 internal SDL_GLContext wrm_gl_context; // gl context obtained from SDL
 
+// headless data
+
+#ifdef WRM_RENDER_HEADLESS
+internal EGLDisplay wrm_egl_display = EGL_NO_DISPLAY;
+internal EGLContext wrm_egl_context = EGL_NO_CONTEXT;
+#endif
+internal GLuint wrm_offscreen_fbo; // stands in for the default framebuffer when headless
+internal GLuint wrm_offscreen_color;
+internal GLuint wrm_offscreen_depth;
+
 // GL data
 
 internal wrm_RGBAf wrm_bg_color; // background color
@@ -335,6 +898,17 @@ internal int wrm_window_height;
 internal int wrm_window_width;
 internal vec3 wrm_world_up = {0.0f, 1.0f, 0.0f};
 internal wrm_Camera wrm_camera;
+internal wrm_Capture wrm_capture;
+internal wrm_Resolution wrm_resolution;  // drawing thread only
+internal float wrm_frame_budget_ms;     // main thread: copied into each frame
+
+// timing data
+
+internal wrm_Timer_Frame wrm_timers[WRM_RENDER_TIMER_LATENCY];
+internal wrm_Timer_Frame *wrm_timer; // the frame currently being drawn
+internal u64 wrm_frame_index;
+internal wrm_render_Stats wrm_stats; // most recent frame with complete CPU and GPU timings
+internal FILE *wrm_stats_csv;
 
 // resource pools
 
@@ -343,10 +917,39 @@ wrm_Pool wrm_meshes;
 wrm_Pool wrm_textures;
 wrm_Pool wrm_models;
 
-/* a list of models to be drawn (used solely in render_draw() )*/
-wrm_List_Model wrm_models_tbd;
-/* a list of UI models (to be drawn with orthographic projection)*/
-wrm_List_Model wrm_ui_tbd;
+internal wrm_Model_Hot wrm_model_hot;
+internal wrm_List_Hierarchy_Node wrm_hierarchy; // every model in use, each parent before its children
+internal bool wrm_hierarchy_dirty;      // models were added or reparented since the hierarchy was listed
+wrm_Pool wrm_trails;
+wrm_Pool wrm_widgets;
+
+internal wrm_Handle wrm_trail_shader;
+internal wrm_Handle wrm_ui_shader;
+internal wrm_UI_Batch wrm_ui;           // drawing thread only
+internal u32 wrm_ui_version;            // main thread: bumped whenever a widget changes
+internal wrm_GL_State wrm_gl;
+internal wrm_List_Release wrm_releases;     // main thread only
+internal wrm_GL_Garbage wrm_garbage;        // filled by the main thread, emptied by the drawing thread, under wrm_render_lock
+internal wrm_GL_Garbage wrm_garbage_drawing; // drawing thread only: the batch being deleted
+internal GLuint wrm_instance_vbo;       // each frame's draw list, read by instanced shaders as per-instance model matrices
+internal size_t wrm_instance_vbo_size;
+internal u64 wrm_upload_bytes; // bytes sent to the GPU since the last frame was drawn
+
+// frame snapshots: only the first is used unless rendering on a separate thread
+
+internal wrm_render_Frame wrm_frames[WRM_RENDER_FRAMES_IN_FLIGHT];
+internal u32 wrm_frames_built;      // total frames handed off by wrm_render_draw()
+internal u32 wrm_frames_drawn;      // total frames finished by the render thread
+internal u32 wrm_frames_in_flight;
+
+// render thread data
+
+internal SDL_Thread *wrm_render_thread;
+internal SDL_threadID wrm_gl_thread;    // the thread the GL context is current on
+internal SDL_mutex *wrm_render_lock;    // guards the frame queue, the forwarded call, and published stats
+internal SDL_cond *wrm_render_cond;
+internal wrm_GL_Call *wrm_render_call;  // a call waiting to run on the render thread
+internal bool wrm_render_thread_quit;
 
 /*
 Module function definitions
@@ -359,42 +962,56 @@ bool wrm_render_init(const wrm_render_Settings *s, const wrm_Window_Data *data)
 {
     wrm_render_settings = *s;
 
-    if(SDL_Init(SDL_INIT_VIDEO)) {
-        fprintf(stderr, "ERROR: Render: failed to initialize SDL\n");
-        return false;
-    }
-    if(wrm_render_settings.verbose) printf("Render: initialized SDL\n");
-
-    // set gl attributes: version 3.3 core, with double-buffering
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-
-    u32 sdl_flags = SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN;
-    if(data->is_resizable) { sdl_flags |= SDL_WINDOW_RESIZABLE; }
+    wrm_window_width = data->width_px;
+    wrm_window_height = data->height_px;
 
-    // create the window
-    wrm_window = SDL_CreateWindow(
-        data->name,
-        SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-        data->width_px, data->height_px,
-        sdl_flags
-    );
-    SDL_GL_GetDrawableSize(wrm_window, &wrm_window_width, &wrm_window_height);
-    if(!wrm_window) {
-        fprintf(stderr, "ERROR: Render: Failed to create window\n");
-        return false;
+    if(wrm_render_settings.headless) {
+        if(!wrm_render_initHeadless()) return false;
     }
-    if(wrm_render_settings.verbose) printf("Render: created window\n");
+    else {
+        if(SDL_Init(SDL_INIT_VIDEO)) {
+            fprintf(stderr, "ERROR: Render: failed to initialize SDL\n");
+            return false;
+        }
+        if(wrm_render_settings.verbose) printf("Render: initialized SDL\n");
+
+        // set gl attributes: version 3.3 core, with double-buffering
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+        SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+
+        u32 sdl_flags = SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN;
+        if(data->is_resizable) { sdl_flags |= SDL_WINDOW_RESIZABLE; }
+
+        // create the window
+        wrm_window = SDL_CreateWindow(
+            data->name,
+            SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+            data->width_px, data->height_px,
+            sdl_flags
+        );
+        if(!wrm_window) {
+            fprintf(stderr, "ERROR: Render: Failed to create window\n");
+            return false;
+        }
+        SDL_GL_GetDrawableSize(wrm_window, &wrm_window_width, &wrm_window_height);
+        if(wrm_render_settings.verbose) printf("Render: created window\n");
 
-    // get the gl context and load functions
-    wrm_gl_context = SDL_GL_CreateContext(wrm_window);
-    if(!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress)) {
-        fprintf(stderr, "ERROR: Render: Failed to initialize GL functions\n");
-        return false;
+        // get the gl context and load functions
+        wrm_gl_context = SDL_GL_CreateContext(wrm_window);
+        if(!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress)) {
+            fprintf(stderr, "ERROR: Render: Failed to initialize GL functions\n");
+            return false;
+        }
     }
     if(wrm_render_settings.verbose) printf("Render: loaded GL functions\n");
+    wrm_render_resetGLCache();
+
+    if(wrm_render_settings.headless && !wrm_render_createOffscreenTarget()) return false;
+
+    // meshes point their VAOs at the instance buffer, so it has to exist first
+    glGenBuffers(1, &wrm_instance_vbo);
 
     // setup resource lists
     wrm_render_initLists();
@@ -418,6 +1035,8 @@ bool wrm_render_init(const wrm_render_Settings *s, const wrm_Window_Data *data)
     wrm_render_createErrorTexture();
     // setup default mesh (creates default model as well)
     wrm_render_createTestModel();
+    // setup the UI atlas and batch buffer
+    wrm_render_createUIBatch();
     if(wrm_render_settings.verbose) printf(
         "Render: initialized resources\n"
         "\tmodels[cap=%zu,size=%zu]\n"
@@ -430,6 +1049,14 @@ bool wrm_render_init(const wrm_render_Settings *s, const wrm_Window_Data *data)
         wrm_shaders.cap, wrm_shaders.used
     );
 
+    wrm_render_initTimers();
+
+    wrm_resolution = (wrm_Resolution){ .scale = 1.0f };
+    wrm_frame_budget_ms = wrm_render_settings.frame_budget_ms;
+    if(wrm_render_settings.min_render_scale <= 0.0f || wrm_render_settings.min_render_scale > 1.0f) {
+        wrm_render_settings.min_render_scale = WRM_RESOLUTION_DEFAULT_MIN;
+    }
+
     // initialize GL data
     wrm_bg_color = data->background;
     glViewport(0, 0, wrm_window_width, wrm_window_height);
@@ -442,7 +1069,33 @@ bool wrm_render_init(const wrm_render_Settings *s, const wrm_Window_Data *data)
         .yaw = 0.0f
     };
 
+    wrm_gl_thread = SDL_ThreadID();
     wrm_render_is_initialized = true;
+
+    if(wrm_render_settings.threaded) {
+        // hand the context over: from here on only the render thread makes GL calls
+        wrm_render_lock = SDL_CreateMutex();
+        wrm_render_cond = SDL_CreateCond();
+        wrm_render_thread_quit = false;
+        wrm_gl_thread = 0;
+        wrm_render_makeCurrent(false);
+
+        wrm_render_thread = SDL_CreateThread(wrm_render_threadMain, "wrm render", NULL);
+        if(!wrm_render_thread) {
+            fprintf(stderr, "ERROR: Render: failed to start render thread: %s\n", SDL_GetError());
+            wrm_render_settings.threaded = false;
+            wrm_render_makeCurrent(true);
+            wrm_gl_thread = SDL_ThreadID();
+            return true;
+        }
+
+        // wait until the render thread has the context
+        SDL_LockMutex(wrm_render_lock);
+        while(!wrm_gl_thread) SDL_CondWait(wrm_render_cond, wrm_render_lock);
+        SDL_UnlockMutex(wrm_render_lock);
+        if(wrm_render_settings.verbose) printf("Render: started render thread\n");
+    }
+
     return true;
 }
 
@@ -450,12 +1103,127 @@ void wrm_render_quit(void)
 {
     if(!wrm_render_is_initialized) return;
 
+    wrm_render_stopCapture();
+
+    if(wrm_render_thread) {
+        // let the render thread finish the frames in flight, then take the context back
+        SDL_LockMutex(wrm_render_lock);
+        wrm_render_thread_quit = true;
+        SDL_CondBroadcast(wrm_render_cond);
+        SDL_UnlockMutex(wrm_render_lock);
+        SDL_WaitThread(wrm_render_thread, NULL);
+        wrm_render_thread = NULL;
+
+        wrm_render_makeCurrent(true);
+        wrm_gl_thread = SDL_ThreadID();
+        SDL_DestroyCond(wrm_render_cond);
+        SDL_DestroyMutex(wrm_render_lock);
+    }
+
+    for(u32 i = 0; i < WRM_RENDER_TIMER_LATENCY; i++) {
+        glDeleteQueries(WRM_RENDER_TIMESTAMP_COUNT, wrm_timers[i].queries);
+    }
+
+    // no frames are left in flight: destroy everything released, then everything still alive
+    wrm_render_collectReleases(true);
+    for(u32 i = 0; i < wrm_trails.cap; i++) {
+        if(wrm_trails.is_used[i]) wrm_render_destroy(WRM_RENDER_RESOURCE_TRAILS, i);
+    }
+    for(u32 i = 0; i < wrm_meshes.cap; i++) {
+        if(wrm_meshes.is_used[i]) wrm_render_destroy(WRM_RENDER_RESOURCE_MESH, i);
+    }
+    for(u32 i = 0; i < wrm_textures.cap; i++) {
+        if(wrm_textures.is_used[i]) wrm_render_destroy(WRM_RENDER_RESOURCE_TEXTURE, i);
+    }
+    for(u32 i = 0; i < wrm_shaders.cap; i++) {
+        if(wrm_shaders.is_used[i]) wrm_render_destroy(WRM_RENDER_RESOURCE_SHADER, i);
+    }
+    wrm_render_deleteGarbage();
+    free(wrm_releases.data);
+    wrm_releases = (wrm_List_Release){0};
+    wrm_GL_Garbage *lists[] = { &wrm_garbage, &wrm_garbage_drawing };
+    for(u32 i = 0; i < 2; i++) {
+        free(lists[i]->buffers.data);
+        free(lists[i]->vaos.data);
+        free(lists[i]->textures.data);
+        free(lists[i]->programs.data);
+        free(lists[i]->shaders.data);
+        *lists[i] = (wrm_GL_Garbage){0};
+    }
+
     wrm_Pool_delete(&wrm_shaders);
     wrm_Pool_delete(&wrm_textures);
     wrm_Pool_delete(&wrm_meshes);
+    wrm_Model *models = (wrm_Model*)wrm_models.data;
+    for(u32 i = 0; i < wrm_models.cap; i++) {
+        if(wrm_models.is_used[i]) free(models[i].children);
+    }
     wrm_Pool_delete(&wrm_models);
+    free(wrm_model_hot.worlds);
+    free(wrm_model_hot.radii);
+    free(wrm_model_hot.keys);
+    free(wrm_model_hot.flags);
+    free(wrm_hierarchy.data);
+    wrm_model_hot = (wrm_Model_Hot){0};
+    wrm_hierarchy = (wrm_List_Hierarchy_Node){0};
+
+    wrm_Pool_delete(&wrm_trails);
+
+    wrm_Widget *widgets = (wrm_Widget*)wrm_widgets.data;
+    for(u32 i = 0; i < wrm_widgets.cap; i++) {
+        if(wrm_widgets.is_used[i]) free(widgets[i].vertices.data);
+    }
+    wrm_Pool_delete(&wrm_widgets);
+    wrm_render_glForgetVertexArray(wrm_ui.vao);
+    wrm_render_glForgetBuffer(wrm_ui.vbo);
+    wrm_render_glForgetTexture(wrm_ui.atlas);
+    glDeleteVertexArrays(1, &wrm_ui.vao);
+    glDeleteBuffers(1, &wrm_ui.vbo);
+    glDeleteTextures(1, &wrm_ui.atlas);
+    wrm_ui = (wrm_UI_Batch){0};
+    wrm_ui_version = 0;
+
+    for(u32 i = 0; i < WRM_RENDER_FRAMES_IN_FLIGHT; i++) {
+        free(wrm_frames[i].models_tbd.data);
+        free(wrm_frames[i].ui_tbd.data);
+        free(wrm_frames[i].runs.data);
+        free(wrm_frames[i].trails.data);
+        free(wrm_frames[i].ui_vertices.data);
+        wrm_frames[i].runs = (wrm_List_Run){0};
+        wrm_frames[i].trails = (wrm_List_Handle){0};
+        wrm_frames[i].ui_vertices = (wrm_List_UI_Vertex){0};
+        wrm_frames[i].ui_version = 0;
+    }
+    wrm_render_glForgetBuffer(wrm_instance_vbo);
+    glDeleteBuffers(1, &wrm_instance_vbo);
+    wrm_instance_vbo = 0;
+    wrm_instance_vbo_size = 0;
+
+    if(wrm_resolution.fbo) {
+        glDeleteFramebuffers(1, &wrm_resolution.fbo);
+        glDeleteRenderbuffers(1, &wrm_resolution.color);
+        glDeleteRenderbuffers(1, &wrm_resolution.depth);
+        wrm_resolution.fbo = 0;
+    }
+
+    if(wrm_offscreen_fbo) {
+        glDeleteFramebuffers(1, &wrm_offscreen_fbo);
+        glDeleteRenderbuffers(1, &wrm_offscreen_color);
+        glDeleteRenderbuffers(1, &wrm_offscreen_depth);
+        wrm_offscreen_fbo = 0;
+    }
 
-    free(wrm_models_tbd.data);
+    if(wrm_render_settings.headless) {
+#ifdef WRM_RENDER_HEADLESS
+        eglMakeCurrent(wrm_egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(wrm_egl_display, wrm_egl_context);
+        eglTerminate(wrm_egl_display);
+        wrm_egl_context = EGL_NO_CONTEXT;
+        wrm_egl_display = EGL_NO_DISPLAY;
+#endif
+        wrm_render_is_initialized = false;
+        return;
+    }
 
     SDL_GL_DeleteContext(wrm_gl_context);
     
@@ -465,78 +1233,204 @@ void wrm_render_quit(void)
     }
 
     SDL_Quit();
+    wrm_render_is_initialized = false;
 }
 
 void wrm_render_draw(float delta_time /*, bool show_ui*/) 
 {
-    glDisable(GL_CULL_FACE);
-    glEnable(GL_DEPTH_TEST);
-    // clear the screen
-    glClearColor(wrm_bg_color.r, wrm_bg_color.g, wrm_bg_color.b, wrm_bg_color.a);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    wrm_render_collectReleases(false);
 
-    // handle camera and get view matrix
-    mat4 view;
-    wrm_render_getViewMatrix(view);
+    if(!wrm_render_thread) {
+        wrm_render_buildFrame(wrm_frames, delta_time);
+        wrm_render_drawFrame(wrm_frames);
+        return;
+    }
 
-    // get the perspective projection matrix (account for changes in window dimensions and camera fov)
-    mat4 persp;
-    float aspect_ratio = (float) wrm_window_width / (float) wrm_window_height;
-    glm_perspective(wrm_camera.fov, aspect_ratio, WRM_NEAR_CLIP_DISTANCE, WRM_FAR_CLIP_DISTANCE, persp);
+    // wait for a free snapshot: this is the only point the caller blocks on the render thread
+    SDL_LockMutex(wrm_render_lock);
+    while(wrm_frames_in_flight == WRM_RENDER_FRAMES_IN_FLIGHT) {
+        SDL_CondWait(wrm_render_cond, wrm_render_lock);
+    }
+    SDL_UnlockMutex(wrm_render_lock);
 
-    // prepare a list of models for rendering
-    wrm_render_prepareModels();
-    
-    // initialize GL state and tracking of changes
-    wrm_Model *prev = NULL;
-    wrm_Model *curr = wrm_models_tbd.data;
-    u32 elements = 0;
+    // the render thread never reads a snapshot that has not been handed off, so build it unlocked
+    wrm_render_buildFrame(wrm_frames + wrm_frames_built % WRM_RENDER_FRAMES_IN_FLIGHT, delta_time);
 
-    mat4 model;
-    
+    SDL_LockMutex(wrm_render_lock);
+    wrm_frames_built++;
+    wrm_frames_in_flight++;
+    SDL_CondBroadcast(wrm_render_cond);
+    SDL_UnlockMutex(wrm_render_lock);
+}
 
-    // render all the models to backbuffer
-    for(int i = 0; i < wrm_models_tbd.len; i++) {
+void wrm_render_getStats(wrm_render_Stats *dest)
+{
+    if(!dest) return;
+    if(wrm_render_thread) SDL_LockMutex(wrm_render_lock);
+    *dest = wrm_stats;
+    if(wrm_render_thread) SDL_UnlockMutex(wrm_render_lock);
+}
 
-        wrm_render_setGLState(curr, prev, model, view, persp, &elements);
+void wrm_render_setStatsCSV(FILE *out)
+{
+    if(wrm_render_thread) SDL_LockMutex(wrm_render_lock);
+    wrm_stats_csv = out;
+    if(out) {
+        fprintf(out, "frame,frame_ms,cpu_build_ms,cpu_sort_ms,cpu_submit_ms,gpu_upload_ms,gpu_opaque_ms,gpu_ui_ms,gpu_total_ms,draw_calls,models_drawn,models_culled,upload_bytes,gl_calls_issued,gl_calls_skipped,gpu_bound,render_scale\n");
+    }
+    if(wrm_render_thread) SDL_UnlockMutex(wrm_render_lock);
+}
 
-        // render
-        glDrawElements(GL_TRIANGLES, elements, GL_UNSIGNED_INT, NULL);
+void wrm_render_setFrameBudget(float budget_ms)
+{
+    wrm_frame_budget_ms = budget_ms > 0.0f ? budget_ms : 0.0f;
+}
 
-        prev = curr;
-        curr++;
+SDL_Window *wrm_render_getWindow(void)
+{
+    return wrm_window;
+}
+
+void wrm_render_getWindowSize(u32 *width, u32 *height)
+{
+    if(width) *width = (u32)wrm_window_width;
+    if(height) *height = (u32)wrm_window_height;
+}
+
+bool wrm_render_readPixels(u8 *dest, u32 *width, u32 *height)
+{
+    if(!wrm_render_is_initialized) return false;
+    if(!wrm_render_ownsContext()) {
+        wrm_GL_Call call = { .fn = wrm_render_readPixelsCall, .ptrs = { dest } };
+        wrm_render_callOnRenderThread(&call);
+        if(width) *width = (u32)wrm_window_width;
+        if(height) *height = (u32)wrm_window_height;
+        return call.success;
     }
 
-    // space for future post-processing effects
+    if(width) *width = (u32)wrm_window_width;
+    if(height) *height = (u32)wrm_window_height;
+    if(!dest) return true;
+
+    // when windowed the back buffer is undefined after a swap, so read the front buffer
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, wrm_offscreen_fbo);
+    if(!wrm_offscreen_fbo) glReadBuffer(GL_FRONT);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, wrm_window_width, wrm_window_height, GL_RGBA, GL_UNSIGNED_BYTE, dest);
+    if(!wrm_offscreen_fbo) glReadBuffer(GL_BACK);
+
+    return glGetError() == GL_NO_ERROR;
+}
+
+// capture
 
-    // space for UI rendering pass
-    // use orthographic projection
-    glm_ortho(0.0f, wrm_window_width, 0.0f, wrm_window_height, 0.0f, 1.0f, view);
-    glDisable(GL_DEPTH_TEST);
+bool wrm_render_startCapture(FILE *out, u32 fps)
+{
+    if(!wrm_render_ownsContext()) {
+        wrm_GL_Call call = { .fn = wrm_render_startCaptureCall, .ptrs = { out }, .vals = { fps } };
+        wrm_render_callOnRenderThread(&call);
+        return call.success;
+    }
+    if(!wrm_render_is_initialized || wrm_capture.active || !out) return false;
 
-    for(int i = 0; i < wrm_ui_tbd.len; i++) {
+    wrm_capture = (wrm_Capture){
+        .out = out,
+        .w = (u32)wrm_window_width,
+        .h = (u32)wrm_window_height,
+    };
+    size_t frame_size = (size_t)wrm_capture.w * wrm_capture.h * 4;
 
+    for(u32 i = 0; i < WRM_CAPTURE_QUEUE_LEN; i++) {
+        wrm_capture.slots[i] = malloc(frame_size);
+        if(!wrm_capture.slots[i]) {
+            if(wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: startCapture(): failed to allocate frame buffers\n");
+            for(u32 j = 0; j < i; j++) free(wrm_capture.slots[j]);
+            return false;
+        }
     }
 
+    glGenBuffers(2, wrm_capture.pbos);
+    for(u32 i = 0; i < 2; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, wrm_capture.pbos[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frame_size, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // C420jpeg is full-range BT.601, matching the conversion done in the writer
+    fprintf(out, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", wrm_capture.w, wrm_capture.h, fps);
+
+    wrm_capture.lock = SDL_CreateMutex();
+    wrm_capture.cond = SDL_CreateCond();
+    wrm_capture.writer = SDL_CreateThread(wrm_render_captureWriter, "wrm capture", NULL);
+    if(!wrm_capture.writer) {
+        if(wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: startCapture(): failed to start writer thread: %s\n", SDL_GetError());
+        glDeleteBuffers(2, wrm_capture.pbos);
+        SDL_DestroyCond(wrm_capture.cond);
+        SDL_DestroyMutex(wrm_capture.lock);
+        for(u32 i = 0; i < WRM_CAPTURE_QUEUE_LEN; i++) free(wrm_capture.slots[i]);
+        wrm_capture = (wrm_Capture){0};
+        return false;
+    }
 
-    // swap the buffers to present the completed frame
-    SDL_GL_SwapWindow(wrm_window);
+    wrm_capture.active = true;
+    if(wrm_render_settings.verbose) printf("Render: started capture [%ux%u @ %u fps]\n", wrm_capture.w, wrm_capture.h, fps);
+    return true;
 }
 
-SDL_Window *wrm_render_getWindow(void)
+void wrm_render_stopCapture(void)
 {
-    return wrm_window;
+    if(!wrm_render_ownsContext()) {
+        wrm_GL_Call call = { .fn = wrm_render_stopCaptureCall };
+        wrm_render_callOnRenderThread(&call);
+        return;
+    }
+    if(!wrm_capture.active) return;
+
+    // the last frame read is still sitting in its PBO
+    if(wrm_capture.frames_read > 0) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, wrm_capture.pbos[(wrm_capture.frames_read - 1) % 2]);
+        const u8 *rgba = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)wrm_capture.w * wrm_capture.h * 4, GL_MAP_READ_BIT);
+        if(rgba) {
+            wrm_render_captureEnqueue(rgba);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    SDL_LockMutex(wrm_capture.lock);
+    wrm_capture.stopping = true;
+    SDL_CondBroadcast(wrm_capture.cond);
+    SDL_UnlockMutex(wrm_capture.lock);
+    SDL_WaitThread(wrm_capture.writer, NULL);
+
+    fflush(wrm_capture.out);
+    if(wrm_render_settings.verbose) printf(
+        "Render: stopped capture [frames=%llu, stalls=%llu]\n",
+        (unsigned long long)wrm_capture.frames_read, (unsigned long long)wrm_capture.frames_stalled
+    );
+
+    glDeleteBuffers(2, wrm_capture.pbos);
+    SDL_DestroyCond(wrm_capture.cond);
+    SDL_DestroyMutex(wrm_capture.lock);
+    for(u32 i = 0; i < WRM_CAPTURE_QUEUE_LEN; i++) free(wrm_capture.slots[i]);
+    wrm_capture = (wrm_Capture){0};
 }
 
 // shader
 
 wrm_Option_Handle wrm_render_createShader(const char *vert_text, const char *frag_text, bool needs_col, bool needs_tex)
 {
+    if(!wrm_render_ownsContext()) {
+        wrm_GL_Call call = { .fn = wrm_render_createShaderCall, .ptrs = { vert_text, frag_text }, .vals = { needs_col, needs_tex } };
+        wrm_render_callOnRenderThread(&call);
+        return call.handle;
+    }
+
     wrm_Option_Handle pool_result = wrm_Pool_getSlot(&wrm_shaders);
 
     if(!pool_result.exists) return pool_result;
 
-    wrm_Shader s;
+    wrm_Shader s = { .refs = 1 };
     s.needs_col = needs_col;
     s.needs_tex = needs_tex;
 
@@ -591,14 +1485,15 @@ wrm_Option_Handle wrm_render_createShader(const char *vert_text, const char *fra
     glDetachShader(program, s.frag);
 
     s.program = program;
+    // shaders reading their model matrix per instance get one draw per run of identical models
+    s.instanced = glGetAttribLocation(program, "i_model") == (GLint)WRM_SHADER_ATTRIB_INSTANCE_LOC;
 
     if (s.needs_tex) {
-    glUseProgram(program);
+    wrm_render_glUseProgram(program);
     GLint tex_uniform = glGetUniformLocation(program, "tex");
     if (tex_uniform != -1) {
         glUniform1i(tex_uniform, 0); // Assumes all your textured shaders use GL_TEXTURE0: can later extend to use multiple textures
     }
-    glUseProgram(0); // Optional: Unbind the program
 }
 
     ((wrm_Shader*)wrm_shaders.data)[pool_result.Handle_val] = s;
@@ -609,13 +1504,19 @@ wrm_Option_Handle wrm_render_createShader(const char *vert_text, const char *fra
 
 wrm_Option_Handle wrm_render_createTexture(const wrm_Texture_Data *data)
 {
+    if(!wrm_render_ownsContext()) {
+        wrm_GL_Call call = { .fn = wrm_render_createTextureCall, .ptrs = { data } };
+        wrm_render_callOnRenderThread(&call);
+        return call.handle;
+    }
+
     wrm_Option_Handle result = wrm_Pool_getSlot(&wrm_textures);
 
     if(!result.exists) return result;
 
     GLuint texture;
     glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    wrm_render_glBindTexture(0, texture);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -636,6 +1537,7 @@ wrm_Option_Handle wrm_render_createTexture(const wrm_Texture_Data *data)
     glGenerateMipmap(GL_TEXTURE_2D);
 
     ((wrm_Texture*)wrm_textures.data)[result.Handle_val] = (wrm_Texture){
+        .refs = 1,
         .gl_tex = texture,
         .w = data->width,
         .h = data->height
@@ -648,58 +1550,58 @@ wrm_Option_Handle wrm_render_createTexture(const wrm_Texture_Data *data)
 
 wrm_Option_Handle wrm_render_createMesh(const wrm_Mesh_Data *data)
 {
+    if(!wrm_render_ownsContext()) {
+        wrm_GL_Call call = { .fn = wrm_render_createMeshCall, .ptrs = { data } };
+        wrm_render_callOnRenderThread(&call);
+        return call.handle;
+    }
+
     wrm_Option_Handle result = wrm_Pool_getSlot(&wrm_meshes);
-    GLuint vtx_attrib;
+    if(!result.exists) return result;
 
-    GLuint vao = 0;
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    GLenum usage = data->dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
 
-    GLuint pos_vbo = 0;
-    glGenBuffers(1, &pos_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, pos_vbo);
-    glBufferData(GL_ARRAY_BUFFER, data->vtx_cnt * 3 * sizeof(float), data->positions, GL_STATIC_DRAW);
+    wrm_Mesh m = {
+        .refs = 1,
+        .vtx_cnt = data->vtx_cnt,
+        .tri_cnt = data->tri_cnt,
+        .radius = wrm_render_meshRadius(data->positions, data->vtx_cnt),
+        .cw = data->cw,
+        .dynamic = data->dynamic,
+    };
 
-    vtx_attrib = WRM_SHADER_ATTRIB_POS_LOC;
-    glVertexAttribPointer(vtx_attrib, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(vtx_attrib);
+    glGenVertexArrays(1, &m.vao);
 
-    GLuint col_vbo = 0;
-    if(data->colors) {
-        glGenBuffers(1, &col_vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, col_vbo);
-        glBufferData(GL_ARRAY_BUFFER, data->vtx_cnt * 4 * sizeof(float), data->colors, GL_STATIC_DRAW);
+    glGenBuffers(1, &m.pos_vbo);
+    wrm_render_glBindArrayBuffer(m.pos_vbo);
+    glBufferData(GL_ARRAY_BUFFER, data->vtx_cnt * 3 * sizeof(float), data->positions, usage);
 
-        vtx_attrib = WRM_SHADER_ATTRIB_COL_LOC;
-        glVertexAttribPointer(vtx_attrib, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(vtx_attrib);
+    if(data->colors) {
+        glGenBuffers(1, &m.col_vbo);
+        wrm_render_glBindArrayBuffer(m.col_vbo);
+        glBufferData(GL_ARRAY_BUFFER, data->vtx_cnt * 4 * sizeof(float), data->colors, usage);
     }
 
-    GLuint uv_vbo = 0;
     if(data->uvs) {
-        glGenBuffers(1, &uv_vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, uv_vbo);
-        glBufferData(GL_ARRAY_BUFFER, data->vtx_cnt * 2 * sizeof(float), data->uvs, GL_STATIC_DRAW);
-
-        vtx_attrib = WRM_SHADER_ATTRIB_UV_LOC;
-        glVertexAttribPointer(vtx_attrib, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(vtx_attrib);
+        glGenBuffers(1, &m.uv_vbo);
+        wrm_render_glBindArrayBuffer(m.uv_vbo);
+        glBufferData(GL_ARRAY_BUFFER, data->vtx_cnt * 2 * sizeof(float), data->uvs, usage);
     }
 
-    GLuint ebo = 0;
-    glGenBuffers(1, &ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, data->tri_cnt * 3 * sizeof(u32), data->indices, GL_STATIC_DRAW);
+    // the element buffer binding is VAO state, so bind the VAO first
+    wrm_render_glBindVertexArray(m.vao);
+    glGenBuffers(1, &m.ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, data->tri_cnt * 3 * sizeof(u32), data->indices, usage);
 
-    wrm_Mesh m = {
-        .vao = vao,
-        .pos_vbo = pos_vbo,
-        .col_vbo = col_vbo,
-        .uv_vbo = uv_vbo,
-        .ebo = ebo,
-        .tri_cnt = data->tri_cnt,
-        .cw = data->cw,
-    };
+    wrm_render_setupMeshVAO(&m);
+
+    if(m.dynamic) {
+        m.positions = wrm_render_copyBuffer(data->positions, data->vtx_cnt * 3 * sizeof(float));
+        m.colors = wrm_render_copyBuffer(data->colors, data->vtx_cnt * 4 * sizeof(float));
+        m.uvs = wrm_render_copyBuffer(data->uvs, data->vtx_cnt * 2 * sizeof(float));
+        m.indices = wrm_render_copyBuffer(data->indices, data->tri_cnt * 3 * sizeof(u32));
+    }
 
     ((wrm_Mesh*)wrm_meshes.data)[result.Handle_val] = m;
     return result;
@@ -707,11 +1609,91 @@ wrm_Option_Handle wrm_render_createMesh(const wrm_Mesh_Data *data)
 
 wrm_Option_Handle wrm_render_cloneMesh(wrm_Handle mesh)
 {
-    return OPTION_NONE(Handle);
+    if(!wrm_render_ownsContext()) {
+        wrm_GL_Call call = { .fn = wrm_render_cloneMeshCall, .vals = { mesh } };
+        wrm_render_callOnRenderThread(&call);
+        return call.handle;
+    }
+
+    if(!wrm_render_isInUse(mesh, WRM_RENDER_RESOURCE_MESH, "cloneMesh()")) return OPTION_NONE(Handle);
+
+    wrm_Option_Handle result = wrm_Pool_getSlot(&wrm_meshes);
+    if(!result.exists) return result;
+
+    // the pool may have moved while growing
+    const wrm_Mesh *src = (wrm_Mesh*)wrm_meshes.data + mesh;
+    GLenum usage = src->dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
+
+    wrm_Mesh m = *src;
+    m.refs = 1;
+    m.deleted = false;
+    glGenVertexArrays(1, &m.vao);
+    wrm_render_glBindVertexArray(m.vao);
+
+    // copies stay on the GPU: nothing is read back into client memory
+    m.pos_vbo = wrm_render_cloneBuffer(src->pos_vbo, src->vtx_cnt * 3 * sizeof(float), usage);
+    m.col_vbo = wrm_render_cloneBuffer(src->col_vbo, src->vtx_cnt * 4 * sizeof(float), usage);
+    m.uv_vbo = wrm_render_cloneBuffer(src->uv_vbo, src->vtx_cnt * 2 * sizeof(float), usage);
+    m.ebo = wrm_render_cloneBuffer(src->ebo, src->tri_cnt * 3 * sizeof(u32), usage);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.ebo);
+
+    wrm_render_setupMeshVAO(&m);
+
+    if(m.dynamic) {
+        m.positions = wrm_render_copyBuffer(src->positions, src->vtx_cnt * 3 * sizeof(float));
+        m.colors = wrm_render_copyBuffer(src->colors, src->vtx_cnt * 4 * sizeof(float));
+        m.uvs = wrm_render_copyBuffer(src->uvs, src->vtx_cnt * 2 * sizeof(float));
+        m.indices = wrm_render_copyBuffer(src->indices, src->tri_cnt * 3 * sizeof(u32));
+    }
+
+    ((wrm_Mesh*)wrm_meshes.data)[result.Handle_val] = m;
+    return result;
 }
 
 bool wrm_render_updateMesh(wrm_Handle mesh, const wrm_Mesh_Data *data)
 {
+    if(!wrm_render_ownsContext()) {
+        wrm_GL_Call call = { .fn = wrm_render_updateMeshCall, .ptrs = { data }, .vals = { mesh } };
+        wrm_render_callOnRenderThread(&call);
+        return call.success;
+    }
+
+    const char *caller = "updateMesh()";
+    if(!wrm_render_isInUse(mesh, WRM_RENDER_RESOURCE_MESH, caller)) return false;
+    wrm_Mesh *m = (wrm_Mesh*)wrm_meshes.data + mesh;
+
+    // attributes can be left out (NULL) to keep them, but not added: shaders were matched to the mesh's layout
+    if((data->colors && !m->col_vbo) || (data->uvs && !m->uv_vbo)) {
+        if(wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: %s: mesh [%u] has no buffer for some of the given attributes\n", caller, mesh);
+        return false;
+    }
+    bool resized = data->vtx_cnt != m->vtx_cnt;
+    if(resized && (!data->positions || (m->col_vbo && !data->colors) || (m->uv_vbo && !data->uvs))) {
+        if(wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: %s: changing the vertex count of mesh [%u] needs data for every attribute\n", caller, mesh);
+        return false;
+    }
+    if(data->tri_cnt != m->tri_cnt && !data->indices) {
+        if(wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: %s: changing the triangle count of mesh [%u] needs indices\n", caller, mesh);
+        return false;
+    }
+
+    GLenum usage = m->dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
+
+    // the VAO stays valid throughout: buffer names never change, only their contents or storage
+    wrm_upload_bytes += wrm_render_updateBuffer(m->pos_vbo, (void**)&m->positions, data->positions, m->vtx_cnt, data->vtx_cnt, 3 * sizeof(float), usage);
+    wrm_upload_bytes += wrm_render_updateBuffer(m->col_vbo, (void**)&m->colors, data->colors, m->vtx_cnt, data->vtx_cnt, 4 * sizeof(float), usage);
+    wrm_upload_bytes += wrm_render_updateBuffer(m->uv_vbo, (void**)&m->uvs, data->uvs, m->vtx_cnt, data->vtx_cnt, 2 * sizeof(float), usage);
+    wrm_upload_bytes += wrm_render_updateBuffer(m->ebo, (void**)&m->indices, data->indices, m->tri_cnt, data->tri_cnt, 3 * sizeof(u32), usage);
+
+    m->vtx_cnt = data->vtx_cnt;
+    m->tri_cnt = data->tri_cnt;
+    m->cw = data->cw;
+
+    if(data->positions) {
+        m->radius = wrm_render_meshRadius(data->positions, data->vtx_cnt);
+        // which models use this mesh isn't tracked: have every model's bounds recomputed
+        for(size_t i = 0; i < wrm_model_hot.cap; i++) wrm_model_hot.flags[i] |= WRM_MODEL_DIRTY;
+    }
     return true;
 }
 
@@ -726,6 +1708,11 @@ wrm_Option_Handle wrm_render_createModel(const wrm_Model *data, bool use_default
     wrm_Model* model = (wrm_Model*)wrm_models.data + result.Handle_val;
     *model = *data;
 
+    if(!wrm_render_isInUse(data->mesh, WRM_RENDER_RESOURCE_MESH, "createModel()")) {
+        wrm_Pool_freeSlot(&wrm_models, result.Handle_val);
+        return OPTION_NONE(Handle);
+    }
+
 
     wrm_Mesh m = ((wrm_Mesh*)wrm_meshes.data)[data->mesh];
     if(use_default_shader) {
@@ -758,6 +1745,28 @@ wrm_Option_Handle wrm_render_createModel(const wrm_Model *data, bool use_default
         return OPTION_NONE(Handle);
     }
 
+    if(s.needs_tex && !wrm_render_isInUse(data->texture, WRM_RENDER_RESOURCE_TEXTURE, "createModel()")) {
+        wrm_Pool_freeSlot(&wrm_models, result.Handle_val);
+        return OPTION_NONE(Handle);
+    }
+
+    if(!wrm_render_growModelArrays()) {
+        wrm_Pool_freeSlot(&wrm_models, result.Handle_val);
+        return OPTION_NONE(Handle);
+    }
+
+    // the renderer owns the hierarchy: start as a root, then attach to the requested parent
+    model->parent = 0;
+    model->child_count = 0;
+    model->children = NULL;
+    wrm_render_addRef(WRM_RENDER_RESOURCE_MESH, model->mesh);
+    wrm_render_addRef(WRM_RENDER_RESOURCE_TEXTURE, model->texture);
+    wrm_render_addRef(WRM_RENDER_RESOURCE_SHADER, model->shader);
+    wrm_model_hot.keys[result.Handle_val] = wrm_render_modelKey(model);
+    wrm_model_hot.flags[result.Handle_val] = WRM_MODEL_DIRTY | (model->is_visible ? WRM_MODEL_VISIBLE : 0) | (model->is_ui ? WRM_MODEL_UI : 0);
+    wrm_hierarchy_dirty = true;
+    if(data->parent) wrm_render_setModelParent(result.Handle_val, data->parent);
+
     return result;
 }
 
@@ -787,29 +1796,54 @@ void wrm_render_updateModelTransform(wrm_Handle model, const vec3 pos, const vec
     data[model].scale[0] = scale[0];
     data[model].scale[1] = scale[1];
     data[model].scale[2] = scale[2];
+
+    wrm_model_hot.flags[model] |= WRM_MODEL_DIRTY;
 }
 
 void wrm_render_updateModelMesh(wrm_Handle model, wrm_Handle mesh) 
 {
     const char *caller = "updateModelMesh()";
-    if(wrm_render_isInUse(model, WRM_RENDER_RESOURCE_MODEL, caller) && wrm_render_isInUse(mesh, WRM_RENDER_RESOURCE_MESH, caller)) {
-        ((wrm_Model*)wrm_models.data)[model].mesh = mesh;
+    if(!wrm_render_isInUse(model, WRM_RENDER_RESOURCE_MODEL, caller)) return;
+    wrm_Model *m = (wrm_Model*)wrm_models.data + model;
+    // checked first: a model can keep using a mesh whose creator has deleted it
+    if(m->mesh == mesh) return;
+    if(wrm_render_isInUse(mesh, WRM_RENDER_RESOURCE_MESH, caller)) {
+        wrm_render_addRef(WRM_RENDER_RESOURCE_MESH, mesh);
+        wrm_render_releaseRef(WRM_RENDER_RESOURCE_MESH, m->mesh);
+        m->mesh = mesh;
+        wrm_model_hot.keys[model] = wrm_render_modelKey(m);
+        // the bounding radius follows the mesh
+        wrm_model_hot.flags[model] |= WRM_MODEL_DIRTY;
     }
 }
 
 void wrm_render_updateModelTexture(wrm_Handle model, wrm_Handle texture)
 {
     const char *caller = "updateModelTexture()";
-    if(wrm_render_isInUse(model, WRM_RENDER_RESOURCE_MODEL, caller) && wrm_render_isInUse(texture, WRM_RENDER_RESOURCE_TEXTURE, caller)) {
-        ((wrm_Model*)wrm_models.data)[model].texture = texture;
+    if(!wrm_render_isInUse(model, WRM_RENDER_RESOURCE_MODEL, caller)) return;
+    wrm_Model *m = (wrm_Model*)wrm_models.data + model;
+    // checked first: a model can keep using a texture whose creator has deleted it
+    if(m->texture == texture) return;
+    if(wrm_render_isInUse(texture, WRM_RENDER_RESOURCE_TEXTURE, caller)) {
+        wrm_render_addRef(WRM_RENDER_RESOURCE_TEXTURE, texture);
+        wrm_render_releaseRef(WRM_RENDER_RESOURCE_TEXTURE, m->texture);
+        m->texture = texture;
+        wrm_model_hot.keys[model] = wrm_render_modelKey(m);
     }
 }
 
 void wrm_render_updateModelShader(wrm_Handle model, wrm_Handle shader)
 {
     const char *caller = "updateModelShader()";
-    if(wrm_render_isInUse(model, WRM_RENDER_RESOURCE_MODEL, caller) && wrm_render_isInUse(shader, WRM_RENDER_RESOURCE_SHADER, caller)) {
-        ((wrm_Model*)wrm_models.data)[model].shader = shader;
+    if(!wrm_render_isInUse(model, WRM_RENDER_RESOURCE_MODEL, caller)) return;
+    wrm_Model *m = (wrm_Model*)wrm_models.data + model;
+    // checked first: a model can keep using a shader whose creator has deleted it
+    if(m->shader == shader) return;
+    if(wrm_render_isInUse(shader, WRM_RENDER_RESOURCE_SHADER, caller)) {
+        wrm_render_addRef(WRM_RENDER_RESOURCE_SHADER, shader);
+        wrm_render_releaseRef(WRM_RENDER_RESOURCE_SHADER, m->shader);
+        m->shader = shader;
+        wrm_model_hot.keys[model] = wrm_render_modelKey(m);
     }
 }
 
@@ -823,6 +1857,55 @@ void wrm_render_updateModel(wrm_Handle model, const wrm_Model *data)
     wrm_render_updateModelMesh(model, data->mesh);
     wrm_render_updateModelTexture(model, data->texture);
     wrm_render_updateModelShader(model, data->shader);
+
+    wrm_Model *m = (wrm_Model*)wrm_models.data + model;
+    m->is_visible = data->is_visible;
+    m->is_ui = data->is_ui;
+    if(m->is_visible) wrm_model_hot.flags[model] |= WRM_MODEL_VISIBLE;
+    else wrm_model_hot.flags[model] &= ~WRM_MODEL_VISIBLE;
+    if(m->is_ui) wrm_model_hot.flags[model] |= WRM_MODEL_UI;
+    else wrm_model_hot.flags[model] &= ~WRM_MODEL_UI;
+    // children are the renderer's to keep: only the parent is taken from data
+    if(data->parent != m->parent) wrm_render_setModelParent(model, data->parent);
+}
+
+bool wrm_render_setModelParent(wrm_Handle model, wrm_Handle parent)
+{
+    const char *caller = "setModelParent()";
+    if(!wrm_render_isInUse(model, WRM_RENDER_RESOURCE_MODEL, caller)) return false;
+    if(parent && !wrm_render_isInUse(parent, WRM_RENDER_RESOURCE_MODEL, caller)) return false;
+
+    wrm_Model *data = (wrm_Model*)wrm_models.data;
+    if(data[model].parent == parent) return true;
+
+    // walk up from the new parent: finding the model there would make a cycle
+    for(wrm_Handle h = parent; h; h = data[h].parent) {
+        if(h == model) {
+            if(wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: setModelParent(): model [%u] is an ancestor of model [%u]\n", model, parent);
+            return false;
+        }
+    }
+
+    if(parent) {
+        wrm_Model *p = data + parent;
+        // grow by doubling: the capacity is implied by the count, so it only reallocs at powers of two
+        if(p->child_count == 0 || (p->child_count & (p->child_count - 1)) == 0) {
+            u32 cap = p->child_count ? p->child_count * 2 : 1;
+            wrm_Handle *children = realloc(p->children, cap * sizeof(wrm_Handle));
+            if(!children) {
+                if(wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: setModelParent(): failed to allocate children of model [%u]\n", parent);
+                return false;
+            }
+            p->children = children;
+        }
+        p->children[p->child_count++] = model;
+    }
+
+    wrm_render_detachModel(model);
+    data[model].parent = parent;
+    wrm_model_hot.flags[model] |= WRM_MODEL_DIRTY;
+    wrm_hierarchy_dirty = true;
+    return true;
 }
 
 // camera
@@ -853,39 +1936,1620 @@ void wrm_render_getCameraData(float *pitch, float *yaw, float *fov, float *offse
     }
 }
 
+// trails
 
-// these are all defined in the header, but this ensures a compiler symbol is actually emitted for them
-
-wrm_RGBAf wrm_RGBAf_fromRGBAi(wrm_RGBAi rgbai);
+wrm_Option_Handle wrm_render_createTrails(u32 capacity, u32 length, wrm_RGBAf color)
+{
+    if(!wrm_render_ownsContext()) {
+        wrm_GL_Call call = { .fn = wrm_render_createTrailsCall, .ptrs = { &color }, .vals = { capacity, length } };
+        wrm_render_callOnRenderThread(&call);
+        return call.handle;
+    }
 
-wrm_RGBAf wrm_RGBAf_fromRGBA(wrm_RGBA rgba);
+    if(capacity == 0 || length < 2) {
+        if(wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: createTrails(): need at least one point and two samples\n");
+        return OPTION_NONE(Handle);
+    }
 
-wrm_RGBAi wrm_RGBAi_fromRGBAf(wrm_RGBAf rgbaf);
+    wrm_Option_Handle result = wrm_Pool_getSlot(&wrm_trails);
+    if(!result.exists) return result;
 
-wrm_RGBAi wrm_RGBAi_fromRGBA(wrm_RGBA rgba);
+    wrm_Trails t = {
+        .capacity = capacity,
+        .length = length,
+        .color = color,
+        .head = length - 1, // so the first sample lands in slot 0
+        .shown = length,
+        .visible = true,
+    };
 
-wrm_RGBA wrm_RGBA_fromRGBAi(wrm_RGBAi rgbai);
+    u32 *indices = malloc((size_t)capacity * length * 2 * sizeof(u32));
+    if(!indices) {
+        if(wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: createTrails(): failed to allocate index data\n");
+        wrm_Pool_freeSlot(&wrm_trails, result.Handle_val);
+        return OPTION_NONE(Handle);
+    }
+    // segment s joins sample s to sample s + 1 for every point: each segment is one contiguous block
+    for(u32 seg = 0; seg < length; seg++) {
+        u32 *block = indices + (size_t)seg * capacity * 2;
+        u32 next = (seg + 1) % length;
+        for(u32 p = 0; p < capacity; p++) {
+            block[p * 2] = seg * capacity + p;
+            block[p * 2 + 1] = next * capacity + p;
+        }
+    }
+
+    glGenVertexArrays(1, &t.vao);
+    wrm_render_glBindVertexArray(t.vao);
+
+    // the whole ring is allocated up front: memory is fixed at capacity * length no matter how long it runs
+    glGenBuffers(1, &t.vbo);
+    wrm_render_glBindArrayBuffer(t.vbo);
+    glBufferData(GL_ARRAY_BUFFER, (size_t)capacity * length * 3 * sizeof(float), NULL, GL_STREAM_DRAW);
+    glVertexAttribPointer(WRM_SHADER_ATTRIB_POS_LOC, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(WRM_SHADER_ATTRIB_POS_LOC);
+
+    glGenBuffers(1, &t.ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, t.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (size_t)capacity * length * 2 * sizeof(u32), indices, GL_STATIC_DRAW);
+    free(indices);
+
+    wrm_render_glBindVertexArray(0);
+
+    ((wrm_Trails*)wrm_trails.data)[result.Handle_val] = t;
+    return result;
+}
+
+void wrm_render_pushTrails(wrm_Handle trails, const float *positions, u32 count)
+{
+    if(!wrm_render_isInUse(trails, WRM_RENDER_RESOURCE_TRAILS, "pushTrails()")) return;
+    wrm_Trails *t = (wrm_Trails*)wrm_trails.data + trails;
+
+    if(count > t->capacity) count = t->capacity;
+
+    // points added or removed may have been reordered: restart every trail rather than join unrelated samples
+    if(count != t->count) {
+        t->filled = 0;
+        t->pending_cnt = 0;
+    }
+    t->count = count;
+
+    if(t->pending_cap == 0) {
+        t->pending = malloc((size_t)t->capacity * 3 * sizeof(float));
+        if(!t->pending) return;
+        t->pending_cap = 1;
+    }
+    if(t->pending_cnt == t->pending_cap) {
+        if(t->pending_cap < t->length) {
+            // several samples between frames: grow, but never past one full ring
+            u32 cap = t->pending_cap * 2 < t->length ? t->pending_cap * 2 : t->length;
+            float *grown = realloc(t->pending, (size_t)cap * t->capacity * 3 * sizeof(float));
+            if(!grown) return;
+            t->pending = grown;
+            t->pending_cap = cap;
+        }
+        else {
+            // a whole ring's worth is already pending: the oldest row would be overwritten anyway
+            memmove(t->pending, t->pending + (size_t)t->capacity * 3, (size_t)(t->pending_cnt - 1) * t->capacity * 3 * sizeof(float));
+            t->pending_cnt--;
+        }
+    }
+
+    memcpy(t->pending + (size_t)t->pending_cnt * t->capacity * 3, positions, (size_t)count * 3 * sizeof(float));
+    t->pending_cnt++;
+    t->head = (t->head + 1) % t->length;
+    if(t->filled < t->length) t->filled++;
+}
+
+void wrm_render_setTrailsVisible(wrm_Handle trails, bool visible)
+{
+    if(!wrm_render_isInUse(trails, WRM_RENDER_RESOURCE_TRAILS, "setTrailsVisible()")) return;
+    ((wrm_Trails*)wrm_trails.data)[trails].visible = visible;
+}
+
+void wrm_render_setTrailsLength(wrm_Handle trails, u32 length)
+{
+    if(!wrm_render_isInUse(trails, WRM_RENDER_RESOURCE_TRAILS, "setTrailsLength()")) return;
+    wrm_Trails *t = (wrm_Trails*)wrm_trails.data + trails;
+    // the ring keeps recording every sample, so lengthening again shows history that is already there
+    t->shown = length < 2 ? 2 : length > t->length ? t->length : length;
+}
+
+// UI
+
+wrm_Option_Handle wrm_render_createWidget(void)
+{
+    wrm_Option_Handle result = wrm_Pool_getSlot(&wrm_widgets);
+    if(!result.exists) {
+        if(wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: failed to get a slot for a new widget\n");
+        return result;
+    }
+    ((wrm_Widget*)wrm_widgets.data)[result.Handle_val] = (wrm_Widget){ .visible = true };
+    return result;
+}
+
+void wrm_render_clearWidget(wrm_Handle widget)
+{
+    if(!wrm_render_isInUse(widget, WRM_RENDER_RESOURCE_WIDGET, "clearWidget()")) return;
+    wrm_Widget *w = (wrm_Widget*)wrm_widgets.data + widget;
+    if(!w->vertices.len) return;
+    w->vertices.len = 0;
+    wrm_ui_version++;
+}
+
+void wrm_render_addWidgetRect(wrm_Handle widget, float x, float y, float width, float height, wrm_RGBAf color)
+{
+    if(!wrm_render_isInUse(widget, WRM_RENDER_RESOURCE_WIDGET, "addWidgetRect()")) return;
+    if(wrm_render_pushQuad((wrm_Widget*)wrm_widgets.data + widget, x, y, width, height, 0, color)) wrm_ui_version++;
+}
+
+void wrm_render_addWidgetText(wrm_Handle widget, float x, float y, float size, wrm_RGBAf color, const char *text)
+{
+    if(!wrm_render_isInUse(widget, WRM_RENDER_RESOURCE_WIDGET, "addWidgetText()") || !text) return;
+    wrm_Widget *w = (wrm_Widget*)wrm_widgets.data + widget;
+
+    // y is the bottom of the first line; each newline moves down a line
+    float left = x;
+    for(const char *c = text; *c; c++) {
+        if(*c == '\n') {
+            x = left;
+            y -= size;
+            continue;
+        }
+        u32 code = (u8)*c;
+        if(code < ' ' || code > '~') code = '?';
+        if(code != ' ' && !wrm_render_pushQuad(w, x, y, size, size, code, color)) break;
+        x += size;
+    }
+    wrm_ui_version++;
+}
+
+void wrm_render_setWidgetVisible(wrm_Handle widget, bool visible)
+{
+    if(!wrm_render_isInUse(widget, WRM_RENDER_RESOURCE_WIDGET, "setWidgetVisible()")) return;
+    wrm_Widget *w = (wrm_Widget*)wrm_widgets.data + widget;
+    if(w->visible == visible) return;
+    w->visible = visible;
+    wrm_ui_version++;
+}
+
+void wrm_render_deleteWidget(wrm_Handle widget)
+{
+    if(!wrm_render_isInUse(widget, WRM_RENDER_RESOURCE_WIDGET, "deleteWidget()")) return;
+    // widgets have no GL objects of their own: frames in flight hold copies of their vertices
+    wrm_Widget *w = (wrm_Widget*)wrm_widgets.data + widget;
+    free(w->vertices.data);
+    *w = (wrm_Widget){0};
+    wrm_Pool_freeSlot(&wrm_widgets, widget);
+    wrm_ui_version++;
+}
+
+// deletion
+
+void wrm_render_deleteShader(wrm_Handle shader)
+{
+    if(!wrm_render_isInUse(shader, WRM_RENDER_RESOURCE_SHADER, "deleteShader()")) return;
+    ((wrm_Shader*)wrm_shaders.data)[shader].deleted = true;
+    wrm_render_releaseRef(WRM_RENDER_RESOURCE_SHADER, shader);
+}
+
+void wrm_render_deleteTexture(wrm_Handle texture)
+{
+    if(!wrm_render_isInUse(texture, WRM_RENDER_RESOURCE_TEXTURE, "deleteTexture()")) return;
+    ((wrm_Texture*)wrm_textures.data)[texture].deleted = true;
+    wrm_render_releaseRef(WRM_RENDER_RESOURCE_TEXTURE, texture);
+}
+
+void wrm_render_deleteMesh(wrm_Handle mesh)
+{
+    if(!wrm_render_isInUse(mesh, WRM_RENDER_RESOURCE_MESH, "deleteMesh()")) return;
+    ((wrm_Mesh*)wrm_meshes.data)[mesh].deleted = true;
+    wrm_render_releaseRef(WRM_RENDER_RESOURCE_MESH, mesh);
+}
+
+void wrm_render_deleteModel(wrm_Handle model)
+{
+    if(!wrm_render_isInUse(model, WRM_RENDER_RESOURCE_MODEL, "deleteModel()")) return;
+    wrm_Model *data = (wrm_Model*)wrm_models.data;
+    wrm_Model *m = data + model;
+
+    // children stay where they are in the world for now, but as roots
+    for(u32 c = 0; c < m->child_count; c++) {
+        data[m->children[c]].parent = 0;
+        wrm_model_hot.flags[m->children[c]] |= WRM_MODEL_DIRTY;
+    }
+    free(m->children);
+    wrm_render_detachModel(model);
+
+    wrm_render_releaseRef(WRM_RENDER_RESOURCE_MESH, m->mesh);
+    wrm_render_releaseRef(WRM_RENDER_RESOURCE_TEXTURE, m->texture);
+    wrm_render_releaseRef(WRM_RENDER_RESOURCE_SHADER, m->shader);
+
+    // frames in flight hold copies of what they draw, so the slot is free to reuse right away
+    wrm_model_hot.flags[model] = 0;
+    wrm_hierarchy_dirty = true;
+    wrm_Pool_freeSlot(&wrm_models, model);
+}
+
+void wrm_render_deleteTrails(wrm_Handle trails)
+{
+    if(!wrm_render_isInUse(trails, WRM_RENDER_RESOURCE_TRAILS, "deleteTrails()")) return;
+    ((wrm_Trails*)wrm_trails.data)[trails].deleted = true;
+    wrm_render_queueRelease(WRM_RENDER_RESOURCE_TRAILS, trails);
+}
+
+
+// these are all defined in the header, but this ensures a compiler symbol is actually emitted for them
+
+wrm_RGBAf wrm_RGBAf_fromRGBAi(wrm_RGBAi rgbai);
+
+wrm_RGBAf wrm_RGBAf_fromRGBA(wrm_RGBA rgba);
+
+wrm_RGBAi wrm_RGBAi_fromRGBAf(wrm_RGBAf rgbaf);
+
+wrm_RGBAi wrm_RGBAi_fromRGBA(wrm_RGBA rgba);
+
+wrm_RGBA wrm_RGBA_fromRGBAi(wrm_RGBAi rgbai);
+
+wrm_RGBA wrm_RGBA_fromRGBAf(wrm_RGBAf rgbaf);
+
+/*
+Internal helper definitions
+*/
+
+internal void wrm_render_initLists(void)
+{
+    wrm_Pool_init(&wrm_shaders, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Shader));
+    wrm_Pool_init(&wrm_textures, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Texture));
+    wrm_Pool_init(&wrm_meshes, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Mesh));
+    wrm_Pool_init(&wrm_models, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Model));
+    wrm_Pool_init(&wrm_trails, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Trails));
+    wrm_Pool_init(&wrm_widgets, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Widget));
+
+    for(u32 i = 0; i < WRM_RENDER_FRAMES_IN_FLIGHT; i++) {
+        wrm_frames[i].models_tbd = (wrm_List_Draw) {
+            .cap = WRM_RENDER_LIST_INITIAL_CAPACITY, 
+            .len = 0, 
+            .data = (wrm_render_Draw*)calloc(WRM_RENDER_LIST_INITIAL_CAPACITY, sizeof(wrm_render_Draw))
+        };
+        wrm_frames[i].ui_tbd = (wrm_List_Draw) {
+            .cap = WRM_RENDER_LIST_INITIAL_CAPACITY, 
+            .len = 0, 
+            .data = (wrm_render_Draw*)calloc(WRM_RENDER_LIST_INITIAL_CAPACITY, sizeof(wrm_render_Draw))
+        };
+    }
+}
+
+
+internal bool wrm_render_initHeadless(void)
+{
+#ifdef WRM_RENDER_HEADLESS
+    // prefer Mesa's surfaceless platform: it needs no X/Wayland display or DRM device
+    const char *client_exts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if(getPlatformDisplay && client_exts && strstr(client_exts, "EGL_MESA_platform_surfaceless")) {
+        wrm_egl_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if(wrm_egl_display == EGL_NO_DISPLAY) {
+        wrm_egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if(wrm_egl_display == EGL_NO_DISPLAY || !eglInitialize(wrm_egl_display, NULL, NULL)) {
+        fprintf(stderr, "ERROR: Render: headless: failed to get an EGL display\n");
+        return false;
+    }
+    if(!eglBindAPI(EGL_OPENGL_API)) {
+        fprintf(stderr, "ERROR: Render: headless: EGL display does not support desktop OpenGL\n");
+        eglTerminate(wrm_egl_display);
+        return false;
+    }
+
+    const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint n_configs = 0;
+    if(!eglChooseConfig(wrm_egl_display, config_attribs, &config, 1, &n_configs) || n_configs < 1) {
+        fprintf(stderr, "ERROR: Render: headless: no suitable EGL config\n");
+        eglTerminate(wrm_egl_display);
+        return false;
+    }
+
+    // same version and profile as the windowed context
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    wrm_egl_context = eglCreateContext(wrm_egl_display, config, EGL_NO_CONTEXT, context_attribs);
+    if(wrm_egl_context == EGL_NO_CONTEXT) {
+        fprintf(stderr, "ERROR: Render: headless: failed to create a GL 3.3 core context\n");
+        eglTerminate(wrm_egl_display);
+        return false;
+    }
+    // no surface at all: everything is drawn into wrm_offscreen_fbo
+    if(!eglMakeCurrent(wrm_egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, wrm_egl_context)) {
+        fprintf(stderr, "ERROR: Render: headless: failed to make the context current without a surface\n");
+        eglDestroyContext(wrm_egl_display, wrm_egl_context);
+        eglTerminate(wrm_egl_display);
+        return false;
+    }
+    if(!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        fprintf(stderr, "ERROR: Render: Failed to initialize GL functions\n");
+        return false;
+    }
+    if(wrm_render_settings.verbose) printf("Render: created headless context (%s)\n", glGetString(GL_RENDERER));
+    return true;
+#else
+    fprintf(stderr, "ERROR: Render: headless rendering was not compiled in (build with HEADLESS=1)\n");
+    return false;
+#endif
+}
+
+internal bool wrm_render_createOffscreenTarget(void)
+{
+    if(!wrm_render_createTarget(&wrm_offscreen_fbo, &wrm_offscreen_color, &wrm_offscreen_depth)) {
+        fprintf(stderr, "ERROR: Render: offscreen framebuffer is incomplete\n");
+        return false;
+    }
+    if(wrm_render_settings.verbose) printf("Render: created offscreen target [%dx%d]\n", wrm_window_width, wrm_window_height);
+    return true;
+}
+
+internal bool wrm_render_createTarget(GLuint *fbo, GLuint *color, GLuint *depth)
+{
+    glGenRenderbuffers(1, color);
+    glBindRenderbuffer(GL_RENDERBUFFER, *color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, wrm_window_width, wrm_window_height);
+
+    glGenRenderbuffers(1, depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, *depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, wrm_window_width, wrm_window_height);
+
+    glGenFramebuffers(1, fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, *fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, *color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, *depth);
+
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+internal void wrm_render_adjustResolution(const wrm_render_Frame *f)
+{
+    wrm_Resolution *r = &wrm_resolution;
+    if(f->frame_budget_ms <= 0.0f) {
+        r->scale = 1.0f;
+        r->frames = 0;
+        r->opaque_ms = 0.0;
+        r->fixed_ms = 0.0;
+        return;
+    }
+
+    // the GPU's time, not the frame's: that also holds simulation and the wait for vsync, which the scale can't help with
+    if(r->frames < WRM_RESOLUTION_PERIOD) return;
+    double opaque = r->opaque_ms / r->frames;
+    double fixed = r->fixed_ms / r->frames;
+    double average = opaque + fixed;
+    r->frames = 0;
+    r->opaque_ms = 0.0;
+    r->fixed_ms = 0.0;
+
+    // fill cost goes with the pixel count, the square of the scale, and only the 3d pass has its pixels scaled:
+    // it gets what the rest of the GPU's work leaves of the budget; the band between the headroom and the budget is left alone
+    float scale = r->scale;
+    if(average > f->frame_budget_ms) {
+        double room = f->frame_budget_ms - fixed;
+        scale *= room > 0.0 ? sqrtf(room / opaque) : 0.0f;
+        scale = glm_max(scale, r->scale * WRM_RESOLUTION_MAX_DROP);
+    }
+    else if(average < f->frame_budget_ms * WRM_RESOLUTION_HEADROOM) {
+        double room = f->frame_budget_ms * WRM_RESOLUTION_HEADROOM - fixed;
+        scale = opaque > 0.0 ? scale * sqrtf(room / opaque) : 1.0f;
+        scale = glm_min(scale, r->scale + WRM_RESOLUTION_MAX_RISE);
+    }
+    scale = glm_clamp(scale, wrm_render_settings.min_render_scale, 1.0f);
+    if(scale > WRM_RESOLUTION_SNAP) scale = 1.0f;
+    if(scale == r->scale) return;
+
+    if(scale < 1.0f && !r->fbo) {
+        if(!wrm_render_createTarget(&r->fbo, &r->color, &r->depth)) {
+            if(wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: scaled framebuffer is incomplete: drawing at full resolution\n");
+            glDeleteFramebuffers(1, &r->fbo);
+            glDeleteRenderbuffers(1, &r->color);
+            glDeleteRenderbuffers(1, &r->depth);
+            r->fbo = 0;
+            return;
+        }
+    }
+    if(wrm_render_settings.verbose) printf("Render: GPU frames averaging %.2fms against a %.2fms budget: resolution scale %.2f -> %.2f\n", average, f->frame_budget_ms, r->scale, scale);
+    r->scale = scale;
+}
+
+internal inline void wrm_render_present(void)
+{
+    if(wrm_render_settings.headless) {
+        // nothing to show, but make sure the frame is actually submitted
+        glFlush();
+        return;
+    }
+    SDL_GL_SwapWindow(wrm_window);
+}
+
+internal void wrm_render_buildFrame(wrm_render_Frame *f, float delta_time)
+{
+    f->delta_time = delta_time;
+    f->frame_budget_ms = wrm_frame_budget_ms;
+
+    // handle camera and get view matrix
+    wrm_render_getViewMatrix(f->view);
+
+    // get the perspective projection matrix (account for changes in window dimensions and camera fov)
+    float aspect_ratio = (float) wrm_window_width / (float) wrm_window_height;
+    glm_perspective(wrm_camera.fov, aspect_ratio, WRM_NEAR_CLIP_DISTANCE, WRM_FAR_CLIP_DISTANCE, f->persp);
+
+    // the UI uses orthographic projection
+    glm_ortho(0.0f, wrm_window_width, 0.0f, wrm_window_height, 0.0f, 1.0f, f->ortho);
+
+    // prepare a list of models for rendering
+    wrm_render_prepareModels(f);
+
+    wrm_render_stageTrails(f);
+
+    wrm_render_stageUI(f);
+}
+
+internal void wrm_render_drawFrame(wrm_render_Frame *f)
+{
+    u64 cpu_start = SDL_GetPerformanceCounter();
+
+    // pick up timings from earlier frames, then reuse the oldest slot for this one
+    wrm_render_resolveTimers();
+    wrm_timer = wrm_timers + wrm_frame_index % WRM_RENDER_TIMER_LATENCY;
+    wrm_timer->stats = (wrm_render_Stats){
+        .frame = wrm_frame_index,
+        .frame_ms = f->delta_time * 1000.0,
+        .cpu_build_ms = f->cpu_build_ms,
+        .cpu_sort_ms = f->cpu_sort_ms,
+    };
+    glQueryCounter(wrm_timer->queries[WRM_RENDER_TIMESTAMP_START], GL_TIMESTAMP);
+
+    // GL objects released since the last frame go in one batch, before anything is drawn
+    wrm_render_deleteGarbage();
+
+    // per-frame buffer uploads
+    wrm_render_uploadInstances(f);
+    wrm_render_uploadTrails(f);
+    wrm_render_uploadUI(f);
+    wrm_timer->stats.upload_bytes = wrm_upload_bytes;
+    wrm_upload_bytes = 0;
+
+    glQueryCounter(wrm_timer->queries[WRM_RENDER_TIMESTAMP_UPLOAD], GL_TIMESTAMP);
+
+    // a zero fbo is the window's default framebuffer; when scaled, the 3d pass goes to the scaled target's corner
+    wrm_render_adjustResolution(f);
+    bool scaled = wrm_resolution.scale < 1.0f;
+    GLsizei scaled_w = (GLsizei)(wrm_window_width * wrm_resolution.scale);
+    GLsizei scaled_h = (GLsizei)(wrm_window_height * wrm_resolution.scale);
+    if(scaled_w < 1) scaled_w = 1;
+    if(scaled_h < 1) scaled_h = 1;
+    wrm_timer->stats.render_scale = wrm_resolution.scale;
+
+    wrm_render_glSetCap(WRM_GL_CAP_CULL_FACE, false);
+    wrm_render_glSetCap(WRM_GL_CAP_DEPTH_TEST, true);
+    wrm_render_glClearColor(wrm_bg_color);
+    if(scaled) {
+        // only the corner drawn into needs clearing
+        glBindFramebuffer(GL_FRAMEBUFFER, wrm_resolution.fbo);
+        glViewport(0, 0, scaled_w, scaled_h);
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(0, 0, scaled_w, scaled_h);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glDisable(GL_SCISSOR_TEST);
+    }
+    else {
+        glBindFramebuffer(GL_FRAMEBUFFER, wrm_offscreen_fbo);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    // initialize GL state and tracking of changes
+    wrm_render_Draw *prev = NULL;
+    wrm_render_Draw *curr = f->models_tbd.data;
+    u32 elements = 0;
+
+    // render all the models to backbuffer, one draw call per run
+    for(u32 i = 0; i < f->runs.len; i++) {
+        wrm_render_Run run = f->runs.data[i];
+        curr = f->models_tbd.data + run.first;
+
+        wrm_Shader *s = wrm_render_setGLState(curr, prev, f->view, f->persp, &elements);
+
+        // render
+        if(s->instanced) {
+            wrm_render_setInstanceOffset(run.first);
+            glDrawElementsInstanced(GL_TRIANGLES, elements, GL_UNSIGNED_INT, NULL, run.count);
+        }
+        else {
+            GLint model_loc = glGetUniformLocation(s->program, "model");
+            if(model_loc != -1) {
+                glUniformMatrix4fv(model_loc, 1, GL_FALSE, (float*)curr->world);
+            }
+            glDrawElements(GL_TRIANGLES, elements, GL_UNSIGNED_INT, NULL);
+        }
+        wrm_timer->stats.draw_calls++;
+
+        prev = curr;
+    }
+    wrm_timer->stats.models_drawn = f->models_tbd.len;
+    wrm_timer->stats.models_culled = f->models_culled;
+
+    // translucent: after everything opaque, without writing depth
+    wrm_render_drawTrails(f);
+
+    // scale the 3d pass up to the window; the UI is drawn over it at full resolution
+    if(scaled) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, wrm_resolution.fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, wrm_offscreen_fbo);
+        glBlitFramebuffer(0, 0, scaled_w, scaled_h, 0, 0, wrm_window_width, wrm_window_height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, wrm_offscreen_fbo);
+        glViewport(0, 0, wrm_window_width, wrm_window_height);
+    }
+    glQueryCounter(wrm_timer->queries[WRM_RENDER_TIMESTAMP_OPAQUE], GL_TIMESTAMP);
+
+    // space for future post-processing effects
+
+    // UI pass: over everything, in window pixels
+    wrm_render_glSetCap(WRM_GL_CAP_DEPTH_TEST, false);
+    wrm_render_drawUI(f);
+    glQueryCounter(wrm_timer->queries[WRM_RENDER_TIMESTAMP_UI], GL_TIMESTAMP);
+
+    if(wrm_capture.active) wrm_render_captureFrame();
+
+    // calls made between frames, creating resources, count toward the next one
+    wrm_timer->stats.gl_calls_issued = wrm_gl.issued;
+    wrm_timer->stats.gl_calls_skipped = wrm_gl.skipped;
+    wrm_gl.issued = 0;
+    wrm_gl.skipped = 0;
+
+    // the swap itself can block on the GPU, so it is left out of the submission time
+    wrm_timer->stats.cpu_submit_ms = wrm_render_msSince(cpu_start);
+    wrm_timer->pending = true;
+    wrm_frame_index++;
+
+    // swap the buffers to present the completed frame
+    wrm_render_present();
+}
+
+internal bool wrm_render_makeCurrent(bool current)
+{
+    if(wrm_render_settings.headless) {
+#ifdef WRM_RENDER_HEADLESS
+        return eglMakeCurrent(wrm_egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, current ? wrm_egl_context : EGL_NO_CONTEXT);
+#else
+        return false;
+#endif
+    }
+    return SDL_GL_MakeCurrent(wrm_window, current ? wrm_gl_context : NULL) == 0;
+}
+
+internal inline bool wrm_render_ownsContext(void)
+{
+    return !wrm_render_thread || SDL_ThreadID() == wrm_gl_thread;
+}
+
+internal void wrm_render_callOnRenderThread(wrm_GL_Call *call)
+{
+    call->done = false;
+
+    SDL_LockMutex(wrm_render_lock);
+    // one forwarded call at a time
+    while(wrm_render_call) SDL_CondWait(wrm_render_cond, wrm_render_lock);
+    wrm_render_call = call;
+    SDL_CondBroadcast(wrm_render_cond);
+    while(!call->done) SDL_CondWait(wrm_render_cond, wrm_render_lock);
+    SDL_UnlockMutex(wrm_render_lock);
+}
+
+internal int wrm_render_threadMain(void *arg)
+{
+    if(!wrm_render_makeCurrent(true)) {
+        fprintf(stderr, "ERROR: Render: render thread could not take the GL context\n");
+    }
+
+    SDL_LockMutex(wrm_render_lock);
+    wrm_gl_thread = SDL_ThreadID();
+    SDL_CondBroadcast(wrm_render_cond);
+
+    while(true) {
+        while(!wrm_render_call && !wrm_frames_in_flight && !wrm_render_thread_quit) {
+            SDL_CondWait(wrm_render_cond, wrm_render_lock);
+        }
+
+        // frames handed off before a forwarded call was made are drawn first, so the call sees them as done
+        if(wrm_frames_in_flight) {
+            wrm_render_Frame *f = wrm_frames + wrm_frames_drawn % WRM_RENDER_FRAMES_IN_FLIGHT;
+            SDL_UnlockMutex(wrm_render_lock);
+            wrm_render_drawFrame(f);
+            SDL_LockMutex(wrm_render_lock);
+
+            wrm_frames_drawn++;
+            wrm_frames_in_flight--;
+            SDL_CondBroadcast(wrm_render_cond);
+            continue;
+        }
+
+        if(!wrm_render_call) break; // quitting, and nothing left to draw
+
+        wrm_GL_Call *call = wrm_render_call;
+        SDL_UnlockMutex(wrm_render_lock);
+        call->fn(call);
+        SDL_LockMutex(wrm_render_lock);
+        call->done = true;
+        wrm_render_call = NULL;
+        SDL_CondBroadcast(wrm_render_cond);
+    }
+
+    SDL_UnlockMutex(wrm_render_lock);
+    wrm_render_makeCurrent(false);
+    return 0;
+}
+
+internal void wrm_render_readPixelsCall(wrm_GL_Call *call)
+{
+    call->success = wrm_render_readPixels((u8*)call->ptrs[0], NULL, NULL);
+}
+
+internal void wrm_render_startCaptureCall(wrm_GL_Call *call)
+{
+    call->success = wrm_render_startCapture((FILE*)call->ptrs[0], call->vals[0]);
+}
+
+internal void wrm_render_stopCaptureCall(wrm_GL_Call *call)
+{
+    wrm_render_stopCapture();
+}
+
+internal void wrm_render_createShaderCall(wrm_GL_Call *call)
+{
+    call->handle = wrm_render_createShader(call->ptrs[0], call->ptrs[1], call->vals[0], call->vals[1]);
+}
+
+internal void wrm_render_createTextureCall(wrm_GL_Call *call)
+{
+    call->handle = wrm_render_createTexture(call->ptrs[0]);
+}
+
+internal void wrm_render_createMeshCall(wrm_GL_Call *call)
+{
+    call->handle = wrm_render_createMesh(call->ptrs[0]);
+}
+
+internal void wrm_render_cloneMeshCall(wrm_GL_Call *call)
+{
+    call->handle = wrm_render_cloneMesh(call->vals[0]);
+}
+
+internal void wrm_render_updateMeshCall(wrm_GL_Call *call)
+{
+    call->success = wrm_render_updateMesh(call->vals[0], call->ptrs[0]);
+}
+
+internal void wrm_render_addRef(wrm_render_Resource_Type type, wrm_Handle h)
+{
+    switch(type) {
+        case WRM_RENDER_RESOURCE_MESH:
+            if(h < wrm_meshes.cap && wrm_meshes.is_used[h] && !((wrm_Mesh*)wrm_meshes.data)[h].deleted) ((wrm_Mesh*)wrm_meshes.data)[h].refs++;
+            break;
+        case WRM_RENDER_RESOURCE_TEXTURE:
+            if(h < wrm_textures.cap && wrm_textures.is_used[h] && !((wrm_Texture*)wrm_textures.data)[h].deleted) ((wrm_Texture*)wrm_textures.data)[h].refs++;
+            break;
+        case WRM_RENDER_RESOURCE_SHADER:
+            if(h < wrm_shaders.cap && wrm_shaders.is_used[h] && !((wrm_Shader*)wrm_shaders.data)[h].deleted) ((wrm_Shader*)wrm_shaders.data)[h].refs++;
+            break;
+        default:
+            break;
+    }
+}
+
+internal void wrm_render_releaseRef(wrm_render_Resource_Type type, wrm_Handle h)
+{
+    u32 *refs = NULL;
+    switch(type) {
+        case WRM_RENDER_RESOURCE_MESH:
+            if(h < wrm_meshes.cap && wrm_meshes.is_used[h]) refs = &((wrm_Mesh*)wrm_meshes.data)[h].refs;
+            break;
+        case WRM_RENDER_RESOURCE_TEXTURE:
+            if(h < wrm_textures.cap && wrm_textures.is_used[h]) refs = &((wrm_Texture*)wrm_textures.data)[h].refs;
+            break;
+        case WRM_RENDER_RESOURCE_SHADER:
+            if(h < wrm_shaders.cap && wrm_shaders.is_used[h]) refs = &((wrm_Shader*)wrm_shaders.data)[h].refs;
+            break;
+        default:
+            break;
+    }
+    if(!refs || !*refs || --*refs) return;
+
+    wrm_render_queueRelease(type, h);
+}
+
+internal void wrm_render_queueRelease(wrm_render_Resource_Type type, wrm_Handle h)
+{
+    // frames built before now may still draw it: it waits for them rather than stall anything
+    wrm_List_Release *r = &wrm_releases;
+    if(r->len == r->cap) {
+        u32 cap = r->cap ? r->cap * WRM_RENDER_LIST_SCALE_FACTOR : WRM_RENDER_LIST_INITIAL_CAPACITY;
+        wrm_Release *grown = realloc(r->data, cap * sizeof(wrm_Release));
+        if(!grown) {
+            fprintf(stderr, "ERROR: Render: failed to allocate more memory for released resources\n");
+            return;
+        }
+        r->data = grown;
+        r->cap = cap;
+    }
+    r->data[r->len++] = (wrm_Release){ .type = type, .handle = h, .fence = wrm_frames_built };
+}
+
+internal void wrm_render_collectReleases(bool all)
+{
+    if(!wrm_releases.len) return;
+
+    u32 drawn = wrm_frames_drawn;
+    if(wrm_render_thread) {
+        SDL_LockMutex(wrm_render_lock);
+        drawn = wrm_frames_drawn;
+    }
+
+    // released in order, so fences only grow along the list: stop at the first that hasn't passed
+    u32 done = 0;
+    while(done < wrm_releases.len && (all || (i32)(drawn - wrm_releases.data[done].fence) >= 0)) {
+        wrm_render_destroy(wrm_releases.data[done].type, wrm_releases.data[done].handle);
+        done++;
+    }
+    if(wrm_render_thread) SDL_UnlockMutex(wrm_render_lock);
+
+    memmove(wrm_releases.data, wrm_releases.data + done, (wrm_releases.len - done) * sizeof(wrm_Release));
+    wrm_releases.len -= done;
+}
+
+internal void wrm_render_pushGarbage(wrm_List_GLuint *list, GLuint name)
+{
+    if(!name) return;
+    if(list->len == list->cap) {
+        u32 cap = list->cap ? list->cap * WRM_RENDER_LIST_SCALE_FACTOR : WRM_RENDER_LIST_INITIAL_CAPACITY;
+        GLuint *grown = realloc(list->data, cap * sizeof(GLuint));
+        if(!grown) {
+            fprintf(stderr, "ERROR: Render: failed to allocate more memory for GL objects to delete: leaking [%u]\n", name);
+            return;
+        }
+        list->data = grown;
+        list->cap = cap;
+    }
+    list->data[list->len++] = name;
+}
+
+internal void wrm_render_destroy(wrm_render_Resource_Type type, wrm_Handle h)
+{
+    // the caller holds wrm_render_lock when threaded, so the drawing thread can't be swapping the garbage out
+    wrm_GL_Garbage *g = &wrm_garbage;
+    switch(type) {
+        case WRM_RENDER_RESOURCE_MESH: {
+            wrm_Mesh *m = (wrm_Mesh*)wrm_meshes.data + h;
+            wrm_render_pushGarbage(&g->vaos, m->vao);
+            wrm_render_pushGarbage(&g->buffers, m->pos_vbo);
+            wrm_render_pushGarbage(&g->buffers, m->col_vbo);
+            wrm_render_pushGarbage(&g->buffers, m->uv_vbo);
+            wrm_render_pushGarbage(&g->buffers, m->ebo);
+            free(m->positions);
+            free(m->colors);
+            free(m->uvs);
+            free(m->indices);
+            *m = (wrm_Mesh){0};
+            wrm_Pool_freeSlot(&wrm_meshes, h);
+            break;
+        }
+        case WRM_RENDER_RESOURCE_TEXTURE: {
+            wrm_Texture *t = (wrm_Texture*)wrm_textures.data + h;
+            wrm_render_pushGarbage(&g->textures, t->gl_tex);
+            *t = (wrm_Texture){0};
+            wrm_Pool_freeSlot(&wrm_textures, h);
+            break;
+        }
+        case WRM_RENDER_RESOURCE_SHADER: {
+            wrm_Shader *s = (wrm_Shader*)wrm_shaders.data + h;
+            wrm_render_pushGarbage(&g->programs, s->program);
+            wrm_render_pushGarbage(&g->shaders, s->vert);
+            wrm_render_pushGarbage(&g->shaders, s->frag);
+            *s = (wrm_Shader){0};
+            wrm_Pool_freeSlot(&wrm_shaders, h);
+            break;
+        }
+        case WRM_RENDER_RESOURCE_TRAILS: {
+            wrm_Trails *t = (wrm_Trails*)wrm_trails.data + h;
+            wrm_render_pushGarbage(&g->vaos, t->vao);
+            wrm_render_pushGarbage(&g->buffers, t->vbo);
+            wrm_render_pushGarbage(&g->buffers, t->ebo);
+            free(t->pending);
+            for(u32 i = 0; i < WRM_RENDER_FRAMES_IN_FLIGHT; i++) free(t->stages[i].rows);
+            *t = (wrm_Trails){0};
+            wrm_Pool_freeSlot(&wrm_trails, h);
+            break;
+        }
+        default:
+            if(wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: internal: destroy(): invalid resource type [%d]\n", type);
+            break;
+    }
+}
+
+internal void wrm_render_deleteGarbage(void)
+{
+    // take the whole batch at once, leaving an empty list (with the old batch's storage) to be filled
+    if(wrm_render_thread) SDL_LockMutex(wrm_render_lock);
+    wrm_GL_Garbage batch = wrm_garbage;
+    wrm_garbage = wrm_garbage_drawing;
+    if(wrm_render_thread) SDL_UnlockMutex(wrm_render_lock);
+
+    for(u32 i = 0; i < batch.vaos.len; i++) wrm_render_glForgetVertexArray(batch.vaos.data[i]);
+    for(u32 i = 0; i < batch.buffers.len; i++) wrm_render_glForgetBuffer(batch.buffers.data[i]);
+    for(u32 i = 0; i < batch.programs.len; i++) wrm_render_glForgetProgram(batch.programs.data[i]);
+    for(u32 i = 0; i < batch.textures.len; i++) wrm_render_glForgetTexture(batch.textures.data[i]);
+
+    if(batch.vaos.len) glDeleteVertexArrays(batch.vaos.len, batch.vaos.data);
+    if(batch.buffers.len) glDeleteBuffers(batch.buffers.len, batch.buffers.data);
+    if(batch.textures.len) glDeleteTextures(batch.textures.len, batch.textures.data);
+    for(u32 i = 0; i < batch.programs.len; i++) glDeleteProgram(batch.programs.data[i]);
+    for(u32 i = 0; i < batch.shaders.len; i++) glDeleteShader(batch.shaders.data[i]);
+
+    batch.vaos.len = 0;
+    batch.buffers.len = 0;
+    batch.textures.len = 0;
+    batch.programs.len = 0;
+    batch.shaders.len = 0;
+    wrm_garbage_drawing = batch;
+}
+
+internal void wrm_render_resetGLCache(void)
+{
+    wrm_gl = (wrm_GL_State){
+        .active_unit = GL_TEXTURE0,
+        .depth_mask = true,
+        .front_face = GL_CCW,
+        .blend_src = GL_ONE,
+        .blend_dst = GL_ZERO,
+    };
+}
+
+internal inline void wrm_render_glUseProgram(GLuint program)
+{
+    if(wrm_gl.program == program) { wrm_gl.skipped++; return; }
+    glUseProgram(program);
+    wrm_gl.program = program;
+    wrm_gl.issued++;
+}
+
+internal inline void wrm_render_glBindVertexArray(GLuint vao)
+{
+    if(wrm_gl.vao == vao) { wrm_gl.skipped++; return; }
+    glBindVertexArray(vao);
+    wrm_gl.vao = vao;
+    wrm_gl.issued++;
+}
+
+internal inline void wrm_render_glBindArrayBuffer(GLuint buffer)
+{
+    if(wrm_gl.array_buffer == buffer) { wrm_gl.skipped++; return; }
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    wrm_gl.array_buffer = buffer;
+    wrm_gl.issued++;
+}
 
-wrm_RGBA wrm_RGBA_fromRGBAf(wrm_RGBAf rgbaf);
+internal inline void wrm_render_glBindTexture(u32 unit, GLuint texture)
+{
+    if(wrm_gl.textures[unit] == texture) { wrm_gl.skipped++; return; }
+    if(wrm_gl.active_unit != GL_TEXTURE0 + unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        wrm_gl.active_unit = GL_TEXTURE0 + unit;
+        wrm_gl.issued++;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    wrm_gl.textures[unit] = texture;
+    wrm_gl.issued++;
+}
 
-/*
-Internal helper definitions
-*/
+internal inline void wrm_render_glSetCap(wrm_GL_Cap cap, bool enabled)
+{
+    internal const GLenum caps[WRM_GL_CAP_COUNT] = { GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND };
+    if(wrm_gl.enabled[cap] == enabled) { wrm_gl.skipped++; return; }
+    if(enabled) glEnable(caps[cap]);
+    else glDisable(caps[cap]);
+    wrm_gl.enabled[cap] = enabled;
+    wrm_gl.issued++;
+}
 
-internal void wrm_render_initLists(void)
+internal inline void wrm_render_glDepthMask(bool mask)
 {
-    wrm_Pool_init(&wrm_shaders, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Shader));
-    wrm_Pool_init(&wrm_textures, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Texture));
-    wrm_Pool_init(&wrm_meshes, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Mesh));
-    wrm_Pool_init(&wrm_models, WRM_RENDER_POOL_INITIAL_CAPACITY, sizeof(wrm_Model));
+    if(wrm_gl.depth_mask == mask) { wrm_gl.skipped++; return; }
+    glDepthMask(mask ? GL_TRUE : GL_FALSE);
+    wrm_gl.depth_mask = mask;
+    wrm_gl.issued++;
+}
+
+internal inline void wrm_render_glFrontFace(GLenum mode)
+{
+    if(wrm_gl.front_face == mode) { wrm_gl.skipped++; return; }
+    glFrontFace(mode);
+    wrm_gl.front_face = mode;
+    wrm_gl.issued++;
+}
+
+internal inline void wrm_render_glBlendFunc(GLenum src, GLenum dst)
+{
+    if(wrm_gl.blend_src == src && wrm_gl.blend_dst == dst) { wrm_gl.skipped++; return; }
+    glBlendFunc(src, dst);
+    wrm_gl.blend_src = src;
+    wrm_gl.blend_dst = dst;
+    wrm_gl.issued++;
+}
+
+internal inline void wrm_render_glClearColor(wrm_RGBAf color)
+{
+    wrm_RGBAf *c = &wrm_gl.clear_color;
+    if(c->r == color.r && c->g == color.g && c->b == color.b && c->a == color.a) { wrm_gl.skipped++; return; }
+    glClearColor(color.r, color.g, color.b, color.a);
+    *c = color;
+    wrm_gl.issued++;
+}
+
+internal void wrm_render_glForgetBuffer(GLuint buffer)
+{
+    if(wrm_gl.array_buffer == buffer) wrm_gl.array_buffer = 0;
+}
+
+internal void wrm_render_glForgetVertexArray(GLuint vao)
+{
+    if(wrm_gl.vao == vao) wrm_gl.vao = 0;
+}
+
+internal void wrm_render_glForgetProgram(GLuint program)
+{
+    // a program in use is only flagged for deletion, but treat it as unbound so a recycled name gets bound again
+    if(wrm_gl.program == program) wrm_gl.program = 0;
+}
+
+internal void wrm_render_glForgetTexture(GLuint texture)
+{
+    for(u32 i = 0; i < WRM_RENDER_TEXTURE_UNITS; i++) {
+        if(wrm_gl.textures[i] == texture) wrm_gl.textures[i] = 0;
+    }
+}
+
+internal void wrm_render_setupMeshVAO(const wrm_Mesh *m)
+{
+    wrm_render_glBindArrayBuffer(m->pos_vbo);
+    glVertexAttribPointer(WRM_SHADER_ATTRIB_POS_LOC, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(WRM_SHADER_ATTRIB_POS_LOC);
+
+    if(m->col_vbo) {
+        wrm_render_glBindArrayBuffer(m->col_vbo);
+        glVertexAttribPointer(WRM_SHADER_ATTRIB_COL_LOC, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(WRM_SHADER_ATTRIB_COL_LOC);
+    }
+
+    if(m->uv_vbo) {
+        wrm_render_glBindArrayBuffer(m->uv_vbo);
+        glVertexAttribPointer(WRM_SHADER_ATTRIB_UV_LOC, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(WRM_SHADER_ATTRIB_UV_LOC);
+    }
+
+    // one model matrix per instance, as four vec4 columns
+    wrm_render_glBindArrayBuffer(wrm_instance_vbo);
+    for(u32 c = 0; c < 4; c++) {
+        glEnableVertexAttribArray(WRM_SHADER_ATTRIB_INSTANCE_LOC + c);
+        glVertexAttribDivisor(WRM_SHADER_ATTRIB_INSTANCE_LOC + c, 1);
+    }
+    wrm_render_setInstanceOffset(0);
+}
+
+internal void wrm_render_setInstanceOffset(u32 first)
+{
+    // GL 3.3 has no base instance, so each run moves the attribute pointers instead
+    wrm_render_glBindArrayBuffer(wrm_instance_vbo);
+    size_t base = (size_t)first * sizeof(wrm_render_Draw) + offsetof(wrm_render_Draw, world);
+    for(u32 c = 0; c < 4; c++) {
+        glVertexAttribPointer(WRM_SHADER_ATTRIB_INSTANCE_LOC + c, 4, GL_FLOAT, GL_FALSE, sizeof(wrm_render_Draw), (void*)(base + c * sizeof(vec4)));
+    }
+}
+
+internal void wrm_render_uploadInstances(const wrm_render_Frame *f)
+{
+    size_t size = f->models_tbd.len * sizeof(wrm_render_Draw);
+    size_t ui_size = f->ui_tbd.len * sizeof(wrm_render_Draw);
+    if(!size && !ui_size) return;
+
+    // the draw records go up as they are: the matrices are read with the record as their stride, so no repacking
+    wrm_render_glBindArrayBuffer(wrm_instance_vbo);
+    if(size + ui_size > wrm_instance_vbo_size) wrm_instance_vbo_size = (size + ui_size) * 2;
+    // fresh storage every frame: orphans last frame's rather than wait for the GPU to finish reading it
+    glBufferData(GL_ARRAY_BUFFER, wrm_instance_vbo_size, NULL, GL_STREAM_DRAW);
+    if(size) glBufferSubData(GL_ARRAY_BUFFER, 0, size, f->models_tbd.data);
+    // UI models follow the 3d ones, so their instances start at models_tbd.len
+    if(ui_size) glBufferSubData(GL_ARRAY_BUFFER, size, ui_size, f->ui_tbd.data);
+    wrm_upload_bytes += size + ui_size;
+}
+
+internal void wrm_render_findRuns(wrm_render_Frame *f)
+{
+    wrm_List_Run *runs = &f->runs;
+    runs->len = 0;
+    if(runs->cap < f->models_tbd.len) {
+        wrm_render_Run *grown = realloc(runs->data, f->models_tbd.len * sizeof(wrm_render_Run));
+        if(!grown) {
+            fprintf(stderr, "ERROR: Render: failed to allocate more memory for draw runs\n");
+            return;
+        }
+        runs->data = grown;
+        runs->cap = f->models_tbd.len;
+    }
+
+    wrm_render_Draw *draws = f->models_tbd.data;
+    wrm_Shader *shaders = (wrm_Shader*)wrm_shaders.data;
+    for(u32 i = 0; i < f->models_tbd.len; ) {
+        u32 end = i + 1;
+        if(shaders[draws[i].key >> (2 * WRM_RENDER_KEY_BITS)].instanced) {
+            // the list is sorted by key, so identical state is already adjacent
+            while(end < f->models_tbd.len && draws[end].key == draws[i].key) end++;
+        }
+        runs->data[runs->len++] = (wrm_render_Run){ .first = i, .count = end - i };
+        i = end;
+    }
+}
+
+internal void *wrm_render_copyBuffer(const void *src, size_t size)
+{
+    if(!src) return NULL;
+    void *copy = malloc(size);
+    if(copy) memcpy(copy, src, size);
+    return copy;
+}
+
+internal GLuint wrm_render_cloneBuffer(GLuint src, size_t size, GLenum usage)
+{
+    if(!src) return 0;
+
+    GLuint dst = 0;
+    glGenBuffers(1, &dst);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, dst);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, usage);
+    glBindBuffer(GL_COPY_READ_BUFFER, src);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size);
+    return dst;
+}
+
+internal size_t wrm_render_updateBuffer(GLuint buffer, void **shadow, const void *src, size_t old_cnt, size_t new_cnt, size_t elem_size, GLenum usage)
+{
+    if(!buffer || !src) return 0;
+
+    // a target that is not VAO state, so element buffers can be updated without touching any VAO
+    GLenum target = GL_COPY_WRITE_BUFFER;
+    size_t size = new_cnt * elem_size;
+    glBindBuffer(target, buffer);
+
+    // without a copy of the old contents every element counts as changed
+    size_t first = 0;
+    size_t last = new_cnt;
+    if(*shadow && old_cnt == new_cnt) {
+        const u8 *old = *shadow;
+        const u8 *new = src;
+        while(first < new_cnt && !memcmp(old + first * elem_size, new + first * elem_size, elem_size)) first++;
+        if(first == new_cnt) return 0; // nothing changed
+        while(last > first && !memcmp(old + (last - 1) * elem_size, new + (last - 1) * elem_size, elem_size)) last--;
+    }
+
+    size_t dirty = (last - first) * elem_size;
+    if(old_cnt != new_cnt || dirty * 2 > size) {
+        // (mostly) full rewrite: orphan the old storage so the driver never waits on draws still reading it
+        glBufferData(target, size, NULL, usage);
+        glBufferSubData(target, 0, size, src);
+        dirty = size;
+    }
+    else {
+        glBufferSubData(target, first * elem_size, dirty, (const u8*)src + first * elem_size);
+    }
+
+    if(*shadow) {
+        if(old_cnt != new_cnt) {
+            void *grown = realloc(*shadow, size);
+            if(!grown) {
+                // lose the copy rather than diff against stale data: later updates just re-send everything
+                free(*shadow);
+                *shadow = NULL;
+                return dirty;
+            }
+            *shadow = grown;
+        }
+        memcpy((u8*)*shadow + first * elem_size, (const u8*)src + first * elem_size, (last - first) * elem_size);
+    }
+    return dirty;
+}
+
+internal void wrm_render_createTrailsCall(wrm_GL_Call *call)
+{
+    call->handle = wrm_render_createTrails(call->vals[0], call->vals[1], *(const wrm_RGBAf*)call->ptrs[0]);
+}
+
+internal void wrm_render_stageTrails(wrm_render_Frame *f)
+{
+    u32 slot = f - wrm_frames;
+    f->trails.len = 0;
+
+    wrm_Trails *trails = (wrm_Trails*)wrm_trails.data;
+    for(u32 i = 0; i < wrm_trails.cap; i++) {
+        if(!wrm_trails.is_used[i] || trails[i].deleted) continue;
+        wrm_Trails *t = trails + i;
+        wrm_Trail_Stage *stage = t->stages + slot;
+
+        if(f->trails.len == f->trails.cap) {
+            u32 cap = f->trails.cap ? f->trails.cap * WRM_RENDER_LIST_SCALE_FACTOR : WRM_RENDER_LIST_INITIAL_CAPACITY;
+            wrm_Handle *grown = realloc(f->trails.data, cap * sizeof(wrm_Handle));
+            if(!grown) {
+                fprintf(stderr, "ERROR: Render: failed to allocate more memory for the trails to-be-drawn list\n");
+                break;
+            }
+            f->trails.data = grown;
+            f->trails.cap = cap;
+        }
+        f->trails.data[f->trails.len++] = i;
+
+        // swap buffers rather than copy: the frame takes the pending rows, the caller gets the frame's old buffer
+        float *rows = stage->rows;
+        u32 row_cap = stage->row_cap;
+        stage->rows = t->pending;
+        stage->row_cap = t->pending_cap;
+        stage->row_cnt = t->pending_cnt;
+        stage->first = (t->head + t->length + 1 - t->pending_cnt % (t->length + 1)) % t->length;
+        stage->head = t->head;
+        stage->filled = t->filled;
+        stage->count = t->count;
+        stage->shown = t->shown;
+        stage->visible = t->visible;
+
+        t->pending = rows;
+        t->pending_cap = row_cap;
+        t->pending_cnt = 0;
+    }
+}
+
+internal void wrm_render_uploadTrails(wrm_render_Frame *f)
+{
+    u32 slot = f - wrm_frames;
+    wrm_Trails *trails = (wrm_Trails*)wrm_trails.data;
+    for(u32 i = 0; i < f->trails.len; i++) {
+        wrm_Trails *t = trails + f->trails.data[i];
+        wrm_Trail_Stage *stage = t->stages + slot;
+        if(!stage->row_cnt) continue;
+
+        wrm_render_glBindArrayBuffer(t->vbo);
+        size_t row_size = (size_t)stage->count * 3 * sizeof(float);
+        for(u32 r = 0; r < stage->row_cnt; r++) {
+            u32 ring = (stage->first + r) % t->length;
+            glBufferSubData(GL_ARRAY_BUFFER, (size_t)ring * t->capacity * 3 * sizeof(float), row_size, stage->rows + (size_t)r * t->capacity * 3);
+            wrm_upload_bytes += row_size;
+        }
+        stage->row_cnt = 0;
+    }
+}
+
+internal void wrm_render_drawTrails(wrm_render_Frame *f)
+{
+    u32 slot = f - wrm_frames;
+    GLsizei counts[64];
+    const void *offsets[64];
+
+    wrm_Shader *s = (wrm_Shader*)wrm_shaders.data + wrm_trail_shader;
+    bool bound = false;
+
+    wrm_Trails *trails = (wrm_Trails*)wrm_trails.data;
+    for(u32 i = 0; i < f->trails.len; i++) {
+        wrm_Trails *t = trails + f->trails.data[i];
+        wrm_Trail_Stage *stage = t->stages + slot;
+        if(!stage->visible || stage->filled < 2 || !stage->count) continue;
+
+        if(!bound) {
+            wrm_render_glUseProgram(s->program);
+            glUniformMatrix4fv(glGetUniformLocation(s->program, "view"), 1, GL_FALSE, (float*)f->view);
+            glUniformMatrix4fv(glGetUniformLocation(s->program, "persp"), 1, GL_FALSE, (float*)f->persp);
+            wrm_render_glSetCap(WRM_GL_CAP_BLEND, true);
+            wrm_render_glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            wrm_render_glDepthMask(false);
+            bound = true;
+        }
+        glUniform1i(glGetUniformLocation(s->program, "head"), stage->head);
+        glUniform1i(glGetUniformLocation(s->program, "len"), t->length);
+        glUniform1i(glGetUniformLocation(s->program, "capacity"), t->capacity);
+        glUniform1i(glGetUniformLocation(s->program, "shown"), stage->shown);
+        glUniform4f(glGetUniformLocation(s->program, "color"), t->color.r, t->color.g, t->color.b, t->color.a);
+        wrm_render_glBindVertexArray(t->vao);
+
+        // the valid segments run from the oldest sample shown up to the newest: one per pair of filled samples,
+        // and never the one from the newest back around to the oldest
+        u32 drawn = stage->filled < stage->shown ? stage->filled : stage->shown;
+        u32 segments = drawn - 1;
+        u32 seg = (stage->head + t->length + 1 - drawn) % t->length;
+        while(segments) {
+            u32 batch = segments < 64 ? segments : 64;
+            for(u32 b = 0; b < batch; b++) {
+                counts[b] = stage->count * 2;
+                offsets[b] = (const void*)((size_t)seg * t->capacity * 2 * sizeof(u32));
+                seg = (seg + 1) % t->length;
+            }
+            glMultiDrawElements(GL_LINES, counts, GL_UNSIGNED_INT, offsets, batch);
+            wrm_timer->stats.draw_calls++;
+            segments -= batch;
+        }
+    }
+
+    if(bound) {
+        wrm_render_glDepthMask(true);
+        wrm_render_glSetCap(WRM_GL_CAP_BLEND, false);
+    }
+}
+
+internal void wrm_render_createUIBatch(void)
+{
+    // glyph rows go in bottom-up, so v grows upward like the UI's y
+    u8 pixels[WRM_UI_ATLAS_ROWS * WRM_UI_CELL][WRM_UI_ATLAS_COLS * WRM_UI_CELL] = {0};
+    for(u32 code = 0; code < WRM_UI_ATLAS_COLS * WRM_UI_ATLAS_ROWS; code++) {
+        u32 x0 = (code % WRM_UI_ATLAS_COLS) * WRM_UI_CELL;
+        u32 y0 = (code / WRM_UI_ATLAS_COLS) * WRM_UI_CELL;
+        for(u32 row = 0; row < WRM_UI_CELL; row++) {
+            u8 bits = code == 0 ? 0xFF : (code >= ' ' && code <= '~') ? WRM_UI_FONT[code - ' '][row] : 0;
+            for(u32 col = 0; col < WRM_UI_CELL; col++) {
+                pixels[y0 + WRM_UI_CELL - 1 - row][x0 + col] = (bits >> col) & 1 ? 0xFF : 0;
+            }
+        }
+    }
+
+    glGenTextures(1, &wrm_ui.atlas);
+    wrm_render_glBindTexture(0, wrm_ui.atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, WRM_UI_ATLAS_COLS * WRM_UI_CELL, WRM_UI_ATLAS_ROWS * WRM_UI_CELL, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenVertexArrays(1, &wrm_ui.vao);
+    wrm_render_glBindVertexArray(wrm_ui.vao);
+    glGenBuffers(1, &wrm_ui.vbo);
+    wrm_render_glBindArrayBuffer(wrm_ui.vbo);
+    glVertexAttribPointer(WRM_SHADER_ATTRIB_POS_LOC, 2, GL_FLOAT, GL_FALSE, sizeof(wrm_UI_Vertex), (void*)offsetof(wrm_UI_Vertex, pos));
+    glEnableVertexAttribArray(WRM_SHADER_ATTRIB_POS_LOC);
+    glVertexAttribPointer(WRM_SHADER_ATTRIB_UV_LOC, 2, GL_FLOAT, GL_FALSE, sizeof(wrm_UI_Vertex), (void*)offsetof(wrm_UI_Vertex, uv));
+    glEnableVertexAttribArray(WRM_SHADER_ATTRIB_UV_LOC);
+    glVertexAttribPointer(WRM_SHADER_ATTRIB_COL_LOC, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(wrm_UI_Vertex), (void*)offsetof(wrm_UI_Vertex, col));
+    glEnableVertexAttribArray(WRM_SHADER_ATTRIB_COL_LOC);
+    wrm_render_glBindVertexArray(0);
+
+    wrm_ui.count = 0;
+    wrm_ui.version = 0;
+    wrm_ui_version = 0;
+}
+
+internal bool wrm_render_pushQuad(wrm_Widget *w, float x, float y, float width, float height, u32 cell, wrm_RGBAf color)
+{
+    wrm_List_UI_Vertex *v = &w->vertices;
+    if(v->len + 6 > v->cap) {
+        u32 cap = v->cap ? v->cap * WRM_RENDER_LIST_SCALE_FACTOR : WRM_RENDER_LIST_INITIAL_CAPACITY * 6;
+        wrm_UI_Vertex *grown = realloc(v->data, cap * sizeof(wrm_UI_Vertex));
+        if(!grown) {
+            if(wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: failed to allocate more memory for widget vertices\n");
+            return false;
+        }
+        v->data = grown;
+        v->cap = cap;
+    }
+
+    // cell 0 is solid: sample its middle so filtering never reaches a neighbor
+    float u0, v0, u1, v1;
+    float cw = 1.0f / WRM_UI_ATLAS_COLS, ch = 1.0f / WRM_UI_ATLAS_ROWS;
+    if(cell == 0) {
+        u0 = u1 = 0.5f * cw;
+        v0 = v1 = 0.5f * ch;
+    }
+    else {
+        u0 = (cell % WRM_UI_ATLAS_COLS) * cw;
+        v0 = (cell / WRM_UI_ATLAS_COLS) * ch;
+        u1 = u0 + cw;
+        v1 = v0 + ch;
+    }
 
-    wrm_models_tbd = (wrm_List_Model) {
-        .cap = WRM_RENDER_LIST_INITIAL_CAPACITY, 
-        .len = 0, 
-        .data = (wrm_Model*)calloc(WRM_RENDER_LIST_INITIAL_CAPACITY, sizeof(wrm_Model))
+    wrm_RGBAi c = {
+        (u8)(glm_clamp(color.r, 0.0f, 1.0f) * 255.0f + 0.5f),
+        (u8)(glm_clamp(color.g, 0.0f, 1.0f) * 255.0f + 0.5f),
+        (u8)(glm_clamp(color.b, 0.0f, 1.0f) * 255.0f + 0.5f),
+        (u8)(glm_clamp(color.a, 0.0f, 1.0f) * 255.0f + 0.5f),
     };
+    wrm_UI_Vertex corners[4] = {
+        { { x, y }, { u0, v0 }, { c.r, c.g, c.b, c.a } },
+        { { x + width, y }, { u1, v0 }, { c.r, c.g, c.b, c.a } },
+        { { x + width, y + height }, { u1, v1 }, { c.r, c.g, c.b, c.a } },
+        { { x, y + height }, { u0, v1 }, { c.r, c.g, c.b, c.a } },
+    };
+    const u32 order[6] = { 0, 1, 2, 0, 2, 3 };
+    for(u32 i = 0; i < 6; i++) v->data[v->len++] = corners[order[i]];
+    return true;
+}
+
+internal void wrm_render_stageUI(wrm_render_Frame *f)
+{
+    // unchanged since this slot was last built: its vertices are still current, so nothing is copied
+    if(f->ui_version == wrm_ui_version) return;
+
+    wrm_List_UI_Vertex *out = &f->ui_vertices;
+    out->len = 0;
+    wrm_Widget *widgets = (wrm_Widget*)wrm_widgets.data;
+    for(u32 i = 0; i < wrm_widgets.cap; i++) {
+        if(!wrm_widgets.is_used[i] || !widgets[i].visible || !widgets[i].vertices.len) continue;
+        wrm_List_UI_Vertex *v = &widgets[i].vertices;
+
+        if(out->len + v->len > out->cap) {
+            u32 cap = out->cap ? out->cap : v->len;
+            while(cap < out->len + v->len) cap *= WRM_RENDER_LIST_SCALE_FACTOR;
+            wrm_UI_Vertex *grown = realloc(out->data, cap * sizeof(wrm_UI_Vertex));
+            if(!grown) {
+                fprintf(stderr, "ERROR: Render: failed to allocate more memory for the UI batch\n");
+                break;
+            }
+            out->data = grown;
+            out->cap = cap;
+        }
+        memcpy(out->data + out->len, v->data, v->len * sizeof(wrm_UI_Vertex));
+        out->len += v->len;
+    }
+    f->ui_version = wrm_ui_version;
+}
+
+internal void wrm_render_uploadUI(const wrm_render_Frame *f)
+{
+    if(f->ui_version == wrm_ui.version) return;
+
+    size_t size = f->ui_vertices.len * sizeof(wrm_UI_Vertex);
+    wrm_render_glBindArrayBuffer(wrm_ui.vbo);
+    // orphan: earlier frames may still be drawing from the old contents
+    glBufferData(GL_ARRAY_BUFFER, size, f->ui_vertices.data, GL_DYNAMIC_DRAW);
+    wrm_upload_bytes += size;
+    wrm_ui.count = f->ui_vertices.len;
+    wrm_ui.version = f->ui_version;
+}
+
+internal void wrm_render_drawUI(wrm_render_Frame *f)
+{
+    // UI models: through the usual model path, with the UI's projection and no view
+    mat4 identity = GLM_MAT4_IDENTITY_INIT;
+    wrm_render_Draw *prev = NULL;
+    u32 elements = 0;
+    for(u32 i = 0; i < f->ui_tbd.len; i++) {
+        wrm_render_Draw *curr = f->ui_tbd.data + i;
+        wrm_Shader *s = wrm_render_setGLState(curr, prev, identity, f->ortho, &elements);
+        if(s->instanced) {
+            wrm_render_setInstanceOffset(f->models_tbd.len + i);
+            glDrawElementsInstanced(GL_TRIANGLES, elements, GL_UNSIGNED_INT, NULL, 1);
+        }
+        else {
+            GLint model_loc = glGetUniformLocation(s->program, "model");
+            if(model_loc != -1) {
+                glUniformMatrix4fv(model_loc, 1, GL_FALSE, (float*)curr->world);
+            }
+            glDrawElements(GL_TRIANGLES, elements, GL_UNSIGNED_INT, NULL);
+        }
+        wrm_timer->stats.draw_calls++;
+        prev = curr;
+    }
+
+    // widgets: every rectangle and glyph in one call
+    if(!wrm_ui.count) return;
+    GLuint program = ((wrm_Shader*)wrm_shaders.data)[wrm_ui_shader].program;
+    wrm_render_glUseProgram(program);
+    glUniformMatrix4fv(glGetUniformLocation(program, "ortho"), 1, GL_FALSE, (float*)f->ortho);
+    wrm_render_glBindTexture(0, wrm_ui.atlas);
+    wrm_render_glBindVertexArray(wrm_ui.vao);
+    wrm_render_glSetCap(WRM_GL_CAP_BLEND, true);
+    wrm_render_glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArrays(GL_TRIANGLES, 0, wrm_ui.count);
+    wrm_render_glSetCap(WRM_GL_CAP_BLEND, false);
+    wrm_timer->stats.draw_calls++;
+}
+
+internal void wrm_render_initTimers(void)
+{
+    for(u32 i = 0; i < WRM_RENDER_TIMER_LATENCY; i++) {
+        glGenQueries(WRM_RENDER_TIMESTAMP_COUNT, wrm_timers[i].queries);
+        wrm_timers[i].pending = false;
+    }
+    wrm_timer = wrm_timers;
+    wrm_frame_index = 0;
+    wrm_stats = (wrm_render_Stats){0};
+}
+
+internal void wrm_render_resolveTimers(void)
+{
+    // walk from the oldest frame in flight to the newest, stopping at the first that is not done
+    for(u32 i = 0; i < WRM_RENDER_TIMER_LATENCY; i++) {
+        wrm_Timer_Frame *t = wrm_timers + (wrm_frame_index + i) % WRM_RENDER_TIMER_LATENCY;
+        if(!t->pending) continue;
+
+        // timestamps complete in order, so the last one being ready means all of them are
+        GLint available = 0;
+        glGetQueryObjectiv(t->queries[WRM_RENDER_TIMESTAMP_COUNT - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if(!available) {
+            if(i == 0) {
+                // the slot is about to be reused: this frame's GPU timings are lost
+                t->pending = false;
+                continue;
+            }
+            break;
+        }
+
+        GLuint64 ts[WRM_RENDER_TIMESTAMP_COUNT];
+        for(u32 j = 0; j < WRM_RENDER_TIMESTAMP_COUNT; j++) {
+            glGetQueryObjectui64v(t->queries[j], GL_QUERY_RESULT, &ts[j]);
+        }
+        t->stats.gpu_upload_ms = (ts[WRM_RENDER_TIMESTAMP_UPLOAD] - ts[WRM_RENDER_TIMESTAMP_START]) / 1e6;
+        t->stats.gpu_opaque_ms = (ts[WRM_RENDER_TIMESTAMP_OPAQUE] - ts[WRM_RENDER_TIMESTAMP_UPLOAD]) / 1e6;
+        t->stats.gpu_ui_ms = (ts[WRM_RENDER_TIMESTAMP_UI] - ts[WRM_RENDER_TIMESTAMP_OPAQUE]) / 1e6;
+        t->stats.gpu_total_ms = (ts[WRM_RENDER_TIMESTAMP_UI] - ts[WRM_RENDER_TIMESTAMP_START]) / 1e6;
+        // the GPU is the bottleneck when its work for a frame takes longer than the CPU takes to submit one
+        t->stats.gpu_bound = t->stats.gpu_total_ms > t->stats.cpu_submit_ms;
+        t->pending = false;
+
+        // frames still in flight from before the last change say nothing about the current scale
+        if(t->stats.render_scale == wrm_resolution.scale) {
+            wrm_resolution.opaque_ms += t->stats.gpu_opaque_ms;
+            wrm_resolution.fixed_ms += t->stats.gpu_total_ms - t->stats.gpu_opaque_ms;
+            wrm_resolution.frames++;
+        }
+
+        if(wrm_render_thread) SDL_LockMutex(wrm_render_lock);
+        wrm_stats = t->stats;
+        if(wrm_stats_csv) {
+            fprintf(wrm_stats_csv, "%llu,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%u,%u,%u,%llu,%u,%u,%d,%.3f\n",
+                (unsigned long long)wrm_stats.frame, wrm_stats.frame_ms,
+                wrm_stats.cpu_build_ms, wrm_stats.cpu_sort_ms, wrm_stats.cpu_submit_ms,
+                wrm_stats.gpu_upload_ms, wrm_stats.gpu_opaque_ms, wrm_stats.gpu_ui_ms, wrm_stats.gpu_total_ms,
+                wrm_stats.draw_calls, wrm_stats.models_drawn, wrm_stats.models_culled, (unsigned long long)wrm_stats.upload_bytes,
+                wrm_stats.gl_calls_issued, wrm_stats.gl_calls_skipped, wrm_stats.gpu_bound, wrm_stats.render_scale
+            );
+        }
+        if(wrm_render_thread) SDL_UnlockMutex(wrm_render_lock);
+    }
+}
+
+internal inline double wrm_render_msSince(u64 start)
+{
+    return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+internal void wrm_render_captureFrame(void)
+{
+    GLsizeiptr frame_size = (GLsizeiptr)wrm_capture.w * wrm_capture.h * 4;
+
+    // start this frame's transfer: with a PBO bound glReadPixels returns immediately
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, wrm_capture.pbos[wrm_capture.frames_read % 2]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, wrm_capture.w, wrm_capture.h, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+    // the previous frame's transfer has had a whole frame to finish, so mapping it does not stall
+    if(wrm_capture.frames_read > 0) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, wrm_capture.pbos[(wrm_capture.frames_read - 1) % 2]);
+        const u8 *rgba = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frame_size, GL_MAP_READ_BIT);
+        if(rgba) {
+            wrm_render_captureEnqueue(rgba);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        else if(wrm_render_settings.errors) {
+            fprintf(stderr, "ERROR: Render: capture: failed to map frame readback buffer\n");
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    wrm_capture.frames_read++;
+}
+
+internal void wrm_render_captureEnqueue(const u8 *rgba)
+{
+    SDL_LockMutex(wrm_capture.lock);
+    if(wrm_capture.count == WRM_CAPTURE_QUEUE_LEN) {
+        wrm_capture.frames_stalled++;
+        while(wrm_capture.count == WRM_CAPTURE_QUEUE_LEN) {
+            SDL_CondWait(wrm_capture.cond, wrm_capture.lock);
+        }
+    }
+    // the writer never touches a slot past head + count, so this copy can happen unlocked
+    u8 *slot = wrm_capture.slots[(wrm_capture.head + wrm_capture.count) % WRM_CAPTURE_QUEUE_LEN];
+    SDL_UnlockMutex(wrm_capture.lock);
+
+    memcpy(slot, rgba, (size_t)wrm_capture.w * wrm_capture.h * 4);
+
+    SDL_LockMutex(wrm_capture.lock);
+    wrm_capture.count++;
+    SDL_CondBroadcast(wrm_capture.cond);
+    SDL_UnlockMutex(wrm_capture.lock);
 }
 
+internal int wrm_render_captureWriter(void *arg)
+{
+    u32 w = wrm_capture.w;
+    u32 h = wrm_capture.h;
+    u32 cw = (w + 1) / 2;
+    u32 ch = (h + 1) / 2;
+
+    u8 *y_plane = malloc((size_t)w * h);
+    u8 *u_plane = malloc((size_t)cw * ch);
+    u8 *v_plane = malloc((size_t)cw * ch);
+    // without them frames are still taken off the queue, just not written, so the render never waits on a dead writer
+    bool writing = y_plane && u_plane && v_plane;
+    if(!writing && wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: captureWriter(): failed to allocate frame planes: nothing more will be recorded\n");
+
+    while(true) {
+        SDL_LockMutex(wrm_capture.lock);
+        while(wrm_capture.count == 0 && !wrm_capture.stopping) {
+            SDL_CondWait(wrm_capture.cond, wrm_capture.lock);
+        }
+        if(wrm_capture.count == 0) {
+            SDL_UnlockMutex(wrm_capture.lock);
+            break;
+        }
+        const u8 *rgba = wrm_capture.slots[wrm_capture.head];
+        SDL_UnlockMutex(wrm_capture.lock);
+
+        if(writing) {
+            // GL rows run bottom to top, Y4M rows top to bottom
+            for(u32 y = 0; y < h; y++) {
+                const u8 *row = rgba + (size_t)(h - 1 - y) * w * 4;
+                u8 *out = y_plane + (size_t)y * w;
+                for(u32 x = 0; x < w; x++) {
+                    const u8 *p = row + x * 4;
+                    out[x] = (u8)((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+                }
+            }
+            // chroma is averaged over each 2x2 block, clamping at odd edges
+            for(u32 y = 0; y < ch; y++) {
+                u32 y0 = h - 1 - 2 * y;
+                u32 y1 = y0 > 0 ? y0 - 1 : y0;
+                for(u32 x = 0; x < cw; x++) {
+                    u32 x0 = 2 * x;
+                    u32 x1 = x0 + 1 < w ? x0 + 1 : x0;
+                    const u8 *q[4] = {
+                        rgba + ((size_t)y0 * w + x0) * 4, rgba + ((size_t)y0 * w + x1) * 4,
+                        rgba + ((size_t)y1 * w + x0) * 4, rgba + ((size_t)y1 * w + x1) * 4
+                    };
+                    i32 r = (q[0][0] + q[1][0] + q[2][0] + q[3][0]) / 4;
+                    i32 g = (q[0][1] + q[1][1] + q[2][1] + q[3][1]) / 4;
+                    i32 b = (q[0][2] + q[1][2] + q[2][2] + q[3][2]) / 4;
+                    u_plane[y * cw + x] = (u8)((-43 * r - 85 * g + 128 * b + 32768 + 128) >> 8);
+                    v_plane[y * cw + x] = (u8)((128 * r - 107 * g - 21 * b + 32768 + 128) >> 8);
+                }
+            }
+
+            fputs("FRAME\n", wrm_capture.out);
+            fwrite(y_plane, 1, (size_t)w * h, wrm_capture.out);
+            fwrite(u_plane, 1, (size_t)cw * ch, wrm_capture.out);
+            fwrite(v_plane, 1, (size_t)cw * ch, wrm_capture.out);
+        }
+
+        SDL_LockMutex(wrm_capture.lock);
+        wrm_capture.head = (wrm_capture.head + 1) % WRM_CAPTURE_QUEUE_LEN;
+        wrm_capture.count--;
+        SDL_CondBroadcast(wrm_capture.cond);
+        SDL_UnlockMutex(wrm_capture.lock);
+    }
+
+    free(y_plane);
+    free(u_plane);
+    free(v_plane);
+    return 0;
+}
 
 internal wrm_Option_GLuint wrm_render_compileShader(const char *shader_text, GLenum type) 
 {
@@ -917,24 +3581,11 @@ internal wrm_Option_GLuint wrm_render_compileShader(const char *shader_text, GLe
     return (wrm_Option_GLuint){ .exists = true, .GLuint_val = shader };
 }
 
-internal int wrm_render_compareModels(const void *model1, const void *model2)
+internal int wrm_render_compareDraws(const void *draw1, const void *draw2)
 {
-    const wrm_Model *m1 = (wrm_Model*)model1;
-    const wrm_Model *m2 = (wrm_Model*)model2;
-
-    if(m1->shader != m2->shader) {
-        return (i64)(m1->shader) - (i64)(m2->shader);
-    }
-
-    if(m1->texture != m2->texture) {
-        return (i64)(m1->texture) - (i64)(m2->texture);
-    }
-
-    if(m1->mesh != m2->mesh) {
-        return (i64)(m1->mesh) - (i64)(m2->mesh);
-    }
-
-    return 0;
+    u64 k1 = ((const wrm_render_Draw*)draw1)->key;
+    u64 k2 = ((const wrm_render_Draw*)draw2)->key;
+    return (k1 > k2) - (k1 < k2);
 }
 
 internal void wrm_render_createDefaultShaders(void)
@@ -957,6 +3608,18 @@ internal void wrm_render_createDefaultShaders(void)
         if(wrm_render_settings.errors) { fprintf(stderr, "ERROR: Render: failed to create default color + texture shader\n"); }
     }
     wrm_shader_defaults.both  = result.Handle_val;
+
+    result = wrm_render_createShader(WRM_SHADER_TRAIL_V_TEXT, WRM_SHADER_TRAIL_F_TEXT, false, false);
+    if(!result.exists) {
+        if(wrm_render_settings.errors) { fprintf(stderr, "ERROR: Render: failed to create trail shader\n"); }
+    }
+    wrm_trail_shader = result.Handle_val;
+
+    result = wrm_render_createShader(WRM_SHADER_UI_V_TEXT, WRM_SHADER_UI_F_TEXT, true, true);
+    if(!result.exists) {
+        if(wrm_render_settings.errors) { fprintf(stderr, "ERROR: Render: failed to create UI shader\n"); }
+    }
+    wrm_ui_shader = result.Handle_val;
 }
 
 internal void wrm_render_createErrorTexture(void)
@@ -1020,20 +3683,28 @@ internal inline bool wrm_render_isInUse(wrm_Handle h, wrm_render_Resource_Type t
     switch(t) {
         case WRM_RENDER_RESOURCE_SHADER:
             type = "shader";
-            result = h < wrm_shaders.cap && wrm_shaders.is_used[h];
+            result = h < wrm_shaders.cap && wrm_shaders.is_used[h] && !((wrm_Shader*)wrm_shaders.data)[h].deleted;
             break;
         case WRM_RENDER_RESOURCE_TEXTURE:
             type = "texture";
-            result = h < wrm_textures.cap && wrm_textures.is_used[h];
+            result = h < wrm_textures.cap && wrm_textures.is_used[h] && !((wrm_Texture*)wrm_textures.data)[h].deleted;
             break;
         case WRM_RENDER_RESOURCE_MESH:
             type = "mesh";
-            result = h < wrm_meshes.cap && wrm_meshes.is_used[h];
+            result = h < wrm_meshes.cap && wrm_meshes.is_used[h] && !((wrm_Mesh*)wrm_meshes.data)[h].deleted;
             break;
         case WRM_RENDER_RESOURCE_MODEL:
             type = "model";
             result = h < wrm_models.cap && wrm_models.is_used[h];
             break;
+        case WRM_RENDER_RESOURCE_TRAILS:
+            type = "trails";
+            result = h < wrm_trails.cap && wrm_trails.is_used[h] && !((wrm_Trails*)wrm_trails.data)[h].deleted;
+            break;
+        case WRM_RENDER_RESOURCE_WIDGET:
+            type = "widget";
+            result = h < wrm_widgets.cap && wrm_widgets.is_used[h];
+            break;
         default:
             if(wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: internal: isInUse(): invalid resource type [%d]\n", t);
             return false;
@@ -1043,28 +3714,207 @@ internal inline bool wrm_render_isInUse(wrm_Handle h, wrm_render_Resource_Type t
     return result;
 }
 
-internal inline void wrm_render_prepareModels(void)
+internal inline void wrm_render_prepareModels(wrm_render_Frame *f)
 {
+    u64 start = SDL_GetPerformanceCounter();
+
+    wrm_render_updateWorlds();
+
     // clear the list
-    wrm_models_tbd.len = 0;
+    wrm_List_Draw *tbd = &f->models_tbd;
+    tbd->len = 0;
+    f->ui_tbd.len = 0;
+    f->models_culled = 0;
+
+    vec4 planes[6];
+    mat4 view_persp;
+    glm_mat4_mul(f->persp, f->view, view_persp);
+    glm_frustum_planes(view_persp, planes);
+
+    wrm_Model_Hot *hot = &wrm_model_hot;
+    for(size_t i = 0; i < hot->cap; i++) {
+        if(!(hot->flags[i] & WRM_MODEL_VISIBLE)) continue;
+
+        // UI models are placed in window pixels, so the frustum says nothing about them
+        if(hot->flags[i] & WRM_MODEL_UI) {
+            wrm_List_Draw *ui = &f->ui_tbd;
+            if(ui->len == ui->cap) {
+                wrm_render_Draw *grown = realloc(ui->data, WRM_RENDER_LIST_SCALE_FACTOR * ui->cap * sizeof(wrm_render_Draw));
+                if(!grown) {
+                    fprintf(stderr, "ERROR: Render: failed to allocate more memory for UI models to-be-drawn list\n");
+                    continue;
+                }
+                ui->data = grown;
+                ui->cap *= WRM_RENDER_LIST_SCALE_FACTOR;
+            }
+            wrm_render_Draw *d = ui->data + ui->len++;
+            glm_mat4_copy(hot->worlds[i], d->world);
+            d->key = hot->keys[i];
+            continue;
+        }
+
+        // bounding sphere against each frustum plane: planes are normalized, so this is a signed distance
+        float *center = hot->worlds[i][3];
+        bool inside = true;
+        for(u32 p = 0; p < 6 && inside; p++) {
+            inside = glm_vec3_dot(planes[p], center) + planes[p][3] >= -hot->radii[i];
+        }
+        if(!inside) {
+            f->models_culled++;
+            continue;
+        }
+
+        if(tbd->len == tbd->cap) {
+            wrm_render_Draw *grown = realloc(tbd->data, WRM_RENDER_LIST_SCALE_FACTOR * tbd->cap * sizeof(wrm_render_Draw));
+            if(!grown) {
+                fprintf(stderr, "ERROR: Render: failed to allocate more memory for models to-be-drawn list\n");
+                break;
+            }
+            tbd->data = grown;
+            tbd->cap *= WRM_RENDER_LIST_SCALE_FACTOR;
+        }
+        wrm_render_Draw *d = tbd->data + tbd->len++;
+        glm_mat4_copy(hot->worlds[i], d->world);
+        d->key = hot->keys[i];
+    }
+    f->cpu_build_ms = wrm_render_msSince(start);
+
+    start = SDL_GetPerformanceCounter();
+    if(tbd->len > 1) {
+        qsort(tbd->data, tbd->len, sizeof(wrm_render_Draw), wrm_render_compareDraws);
+    }
+    wrm_render_findRuns(f);
+    f->cpu_sort_ms = wrm_render_msSince(start);
+}
+
+internal bool wrm_render_growModelArrays(void)
+{
+    wrm_Model_Hot *hot = &wrm_model_hot;
+    if(hot->cap >= wrm_models.cap) return true;
+
+    size_t cap = wrm_models.cap;
+    mat4 *worlds = realloc(hot->worlds, cap * sizeof(mat4));
+    if(worlds) hot->worlds = worlds;
+    float *radii = realloc(hot->radii, cap * sizeof(float));
+    if(radii) hot->radii = radii;
+    u64 *keys = realloc(hot->keys, cap * sizeof(u64));
+    if(keys) hot->keys = keys;
+    u8 *flags = realloc(hot->flags, cap * sizeof(u8));
+    if(flags) hot->flags = flags;
+    if(!worlds || !radii || !keys || !flags) {
+        if(wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: failed to allocate per-frame data for %zu models\n", cap);
+        return false;
+    }
+    // slots not in use have no flags, so frames skip them
+    memset(hot->flags + hot->cap, 0, cap - hot->cap);
+    hot->cap = cap;
+    return true;
+}
+
+internal inline u64 wrm_render_modelKey(const wrm_Model *m)
+{
+    return ((u64)(m->shader & WRM_RENDER_KEY_MASK) << (2 * WRM_RENDER_KEY_BITS))
+        | ((u64)(m->texture & WRM_RENDER_KEY_MASK) << WRM_RENDER_KEY_BITS)
+        | (u64)(m->mesh & WRM_RENDER_KEY_MASK);
+}
+
+internal float wrm_render_meshRadius(const float *positions, size_t vtx_cnt)
+{
+    if(!positions) return 0.0f;
+    float max2 = 0.0f;
+    for(size_t i = 0; i < vtx_cnt; i++) {
+        float d2 = glm_vec3_norm2((float*)positions + i * 3);
+        if(d2 > max2) max2 = d2;
+    }
+    return sqrtf(max2);
+}
 
+internal void wrm_render_detachModel(wrm_Handle model)
+{
     wrm_Model *data = (wrm_Model*)wrm_models.data;
+    wrm_Handle parent = data[model].parent;
+    if(!parent) return;
+
+    wrm_Model *p = data + parent;
+    for(u32 i = 0; i < p->child_count; i++) {
+        if(p->children[i] == model) {
+            p->children[i] = p->children[--p->child_count];
+            break;
+        }
+    }
+}
+
+internal void wrm_render_rebuildHierarchy(void)
+{
+    wrm_List_Hierarchy_Node *h = &wrm_hierarchy;
+    if(h->cap < wrm_models.used) {
+        wrm_Hierarchy_Node *grown = realloc(h->data, wrm_models.used * sizeof(wrm_Hierarchy_Node));
+        if(!grown) {
+            if(wrm_render_settings.errors) fprintf(stderr, "ERROR: Render: failed to allocate model hierarchy\n");
+            return;
+        }
+        h->data = grown;
+        h->cap = wrm_models.used;
+    }
 
+    wrm_Model *data = (wrm_Model*)wrm_models.data;
+    h->len = 0;
     for(u32 i = 0; i < wrm_models.cap; i++) {
-        if(wrm_models.is_used[i] && data[i].is_visible /* && data[i].parent == 0 */) {
-            /* recursively add models */
-            if(wrm_models_tbd.len == wrm_models_tbd.cap) {
-                if(!realloc(wrm_models_tbd.data, WRM_RENDER_LIST_SCALE_FACTOR * wrm_models_tbd.cap * sizeof(wrm_Model))) {
-                    fprintf(stderr, "ERROR: Render: failed to allocate more memory for models to-be-drawn list\n");
-                    return;
-                }
-            }
-            wrm_models_tbd.data[wrm_models_tbd.len++] = data[i];
+        if(wrm_models.is_used[i] && !data[i].parent) h->data[h->len++] = (wrm_Hierarchy_Node){ .model = i };
+    }
+    // the list is its own queue: each model's children are appended after it
+    for(u32 k = 0; k < h->len; k++) {
+        wrm_Handle parent = h->data[k].model;
+        wrm_Model *m = data + parent;
+        for(u32 c = 0; c < m->child_count; c++) {
+            h->data[h->len++] = (wrm_Hierarchy_Node){ .model = m->children[c], .parent = parent };
         }
     }
+    wrm_hierarchy_dirty = false;
+}
+
+internal void wrm_render_updateWorlds(void)
+{
+    if(wrm_hierarchy_dirty) wrm_render_rebuildHierarchy();
 
-    if(wrm_models_tbd.len > 1) {
-        qsort(wrm_models_tbd.data, wrm_models_tbd.len, sizeof(wrm_Model), wrm_render_compareModels);
+    wrm_Model *data = (wrm_Model*)wrm_models.data;
+    wrm_Mesh *meshes = (wrm_Mesh*)wrm_meshes.data;
+    wrm_Model_Hot *hot = &wrm_model_hot;
+    const u8 moved_mask = WRM_MODEL_DIRTY | WRM_MODEL_MOVED;
+
+    for(u32 k = 0; k < wrm_hierarchy.len; k++) {
+        wrm_Hierarchy_Node n = wrm_hierarchy.data[k];
+        u8 *flags = hot->flags + n.model;
+
+        // parents come first, so a parent's flags already say whether it moved in this pass
+        bool moved = (*flags & WRM_MODEL_DIRTY) || (n.parent && (hot->flags[n.parent] & WRM_MODEL_MOVED));
+        *flags &= ~moved_mask;
+        if(!moved) continue;
+
+        // only models that moved read their cold data: translate * rotate * scale, in the parent's space
+        wrm_Model *m = data + n.model;
+        mat4 local, rot;
+        glm_translate_make(local, m->pos);
+        glm_euler((vec3){ glm_rad(m->rot[0]), glm_rad(m->rot[1]), glm_rad(m->rot[2]) }, rot);
+        glm_mat4_mul(local, rot, local);
+        glm_scale(local, m->scale);
+
+        mat4 *world = hot->worlds + n.model;
+        if(n.parent) {
+            glm_mat4_mul(hot->worlds[n.parent], local, *world);
+        }
+        else {
+            glm_mat4_copy(local, *world);
+        }
+        *flags |= WRM_MODEL_MOVED;
+
+        // the sphere grows with the largest scale along any axis, parents' included
+        float scale2 = glm_vec3_norm2((*world)[0]);
+        float s1 = glm_vec3_norm2((*world)[1]);
+        float s2 = glm_vec3_norm2((*world)[2]);
+        if(s1 > scale2) scale2 = s1;
+        if(s2 > scale2) scale2 = s2;
+        hot->radii[n.model] = meshes[m->mesh].radius * sqrtf(scale2);
     }
 }
 
@@ -1099,14 +3949,18 @@ internal inline void wrm_render_getViewMatrix(mat4 view)
     glm_lookat(eye, target, wrm_world_up, view);
 }
 
-internal inline void wrm_render_setGLState(wrm_Model *curr, wrm_Model *prev, mat4 model, mat4 view, mat4 persp, u32 *elements)
+internal inline wrm_Shader *wrm_render_setGLState(wrm_render_Draw *curr, wrm_render_Draw *prev, mat4 view, mat4 persp, u32 *elements)
 {
-    if(!curr) return;
-    wrm_Shader *s = (wrm_Shader*)wrm_shaders.data + curr->shader;
+    wrm_Handle shader = curr->key >> (2 * WRM_RENDER_KEY_BITS);
+    wrm_Handle texture = (curr->key >> WRM_RENDER_KEY_BITS) & WRM_RENDER_KEY_MASK;
+    wrm_Handle mesh = curr->key & WRM_RENDER_KEY_MASK;
+    u64 prev_key = prev ? prev->key : ~curr->key;
+
+    wrm_Shader *s = (wrm_Shader*)wrm_shaders.data + shader;
     
     
-    if(!prev || curr->shader != prev->shader) {
-        glUseProgram(s->program);
+    if(!prev || (curr->key ^ prev_key) >> (2 * WRM_RENDER_KEY_BITS)) {
+        wrm_render_glUseProgram(s->program);
         GLint view_loc = glGetUniformLocation(s->program, "view");
         if(view_loc != -1) {
             glUniformMatrix4fv(view_loc, 1, GL_FALSE, (float*)view);
@@ -1118,23 +3972,16 @@ internal inline void wrm_render_setGLState(wrm_Model *curr, wrm_Model *prev, mat
         }
     }
     
-    if(!prev || curr->texture != prev->texture) {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, ((wrm_Texture*)wrm_textures.data)[curr->texture].gl_tex);
+    if(!prev || ((curr->key ^ prev_key) >> WRM_RENDER_KEY_BITS) & WRM_RENDER_KEY_MASK) {
+        wrm_render_glBindTexture(0, ((wrm_Texture*)wrm_textures.data)[texture].gl_tex);
     }
 
-    if(!prev || curr->mesh != prev->mesh) {
-        wrm_Mesh *m = (wrm_Mesh*)wrm_meshes.data + curr->mesh;
-        glBindVertexArray(m->vao);
-        glFrontFace(m->cw ? GL_CW : GL_CCW);
+    if(!prev || (curr->key ^ prev_key) & WRM_RENDER_KEY_MASK) {
+        wrm_Mesh *m = (wrm_Mesh*)wrm_meshes.data + mesh;
+        wrm_render_glBindVertexArray(m->vao);
+        wrm_render_glFrontFace(m->cw ? GL_CW : GL_CCW);
         *elements = m->tri_cnt * 3;
     }
     
-    glm_mat4_identity(model);
-    glm_translate(model, curr->pos);
-    GLint model_loc = glGetUniformLocation(s->program, "model");
-    if(model_loc != -1) {
-        glUniformMatrix4fv(model_loc, 1, GL_FALSE, (float*)model);
-    }
-
+    return s;
 }
\ No newline at end of file